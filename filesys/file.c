@@ -1,29 +1,49 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
+/* 파이프 끝이면 inode 대신 pipe 가 있다. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* file_dup() 으로 같이 쓰는 fd 수 */
+	struct pipe *pipe;          /* 파이프 끝이면 그 파이프 */
+	bool pipe_writer;           /* 쓰기 끝인가 */
 };
 
+/* struct file 전용 slab 캐시 */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) {
+	file_cache = kmem_cache_create ("file", sizeof (struct file), 0, NULL);
+	if (file_cache == NULL)
+		PANIC ("file_init: out of memory");
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = inode != NULL ? kmem_cache_alloc (file_cache) : NULL;
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
+		file->pipe = NULL;
+		file->pipe_writer = false;
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 		return NULL;
 	}
 }
@@ -41,7 +61,13 @@ file_reopen (struct file *file) {
  * 실패한 경우 null 포인터를 반환합니다. */
 struct file *
 file_duplicate (struct file *file) {
-	struct file *nfile = file_open (inode_reopen (file->inode));
+	struct file *nfile;
+
+	if (file->pipe != NULL) {
+		pipe_reopen (file->pipe, file->pipe_writer);
+		return file_open_pipe (file->pipe, file->pipe_writer);
+	}
+	nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
 		if (file->deny_write)
@@ -50,16 +76,61 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
+/* PIPE 의 WRITER 쪽 끝을 파일로 연다. 끝 하나를 넘겨받아서, 실패하면
+ * 그 끝을 닫고 NULL 을 돌려준다. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) {
+	struct file *file = kmem_cache_alloc (file_cache);
+
+	if (file == NULL) {
+		pipe_close (pipe, writer);
+		return NULL;
+	}
+	file->inode = NULL;
+	file->pos = 0;
+	file->deny_write = false;
+	file->ref_cnt = 1;
+	file->pipe = pipe;
+	file->pipe_writer = writer;
+	return file;
+}
+
+/* dup2 용. 위치까지 같이 쓰는 FILE 을 하나 더 센다. */
+struct file *
+file_dup (struct file *file) {
+	file->ref_cnt++;
+	return file;
+}
+
 /* Closes FILE. */
+/* file_dup() 한 만큼 닫혀야 실제로 닫힌다. */
 void
 file_close (struct file *file) {
 	if (file != NULL) {
-		file_allow_write (file);
-		inode_close (file->inode);
-		free (file);
+		if (--file->ref_cnt > 0)
+			return;
+		if (file->pipe != NULL)
+			pipe_close (file->pipe, file->pipe_writer);
+		else {
+			file_allow_write (file);
+			inode_close (file->inode);
+		}
+		kmem_cache_free (file_cache, file);
 	}
 }
 
+/* FILE 이 WRITER 쪽 파이프 끝이면 그 파이프, 아니면 NULL. */
+struct pipe *
+file_get_pipe (struct file *file, bool writer) {
+	return file->pipe != NULL && file->pipe_writer == writer ? file->pipe : NULL;
+}
+
+/* FILE 이 파이프 끝인지. 파이프에는 위치나 길이가 없다. */
+bool
+file_is_pipe (struct file *file) {
+	return file->pipe != NULL;
+}
+
 /* Returns the inode encapsulated by FILE. */
 struct inode *
 file_get_inode (struct file *file) {
@@ -142,6 +213,8 @@ file_allow_write (struct file *file) {
 off_t
 file_length (struct file *file) {
 	ASSERT (file != NULL);
+	if (file->pipe != NULL)
+		return 0;
 	return inode_length (file->inode);
 }
 
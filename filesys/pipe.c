@@ -0,0 +1,200 @@
+#include "filesys/pipe.h"
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* 파이프.
+
+   데이터는 한 페이지짜리 링 버퍼에 있다. head 는 지금까지 쓴 바이트
+   수로 쓰는 쪽만 고치고, tail 은 읽은 바이트 수로 읽는 쪽만 고친다.
+   둘 다 계속 늘어나기만 하고 버퍼 위치는 PIPE_SIZE 로 나눈 나머지다.
+   쓰는 쪽은 데이터를 채운 뒤 head 를 release 로 올리고, 읽는 쪽은
+   head 를 acquire 로 읽으니 두 쪽이 락을 같이 잡을 일은 없다.
+   fork 로 같은 쪽 끝이 여럿 생길 수 있어서 같은 쪽끼리만
+   read_lock/write_lock 으로 줄을 세운다 (single producer/consumer).
+
+   비었거나 꽉 차서 기다려야 할 때만 인터럽트를 끄고 조건을 다시
+   본 뒤 *_waiting 을 세우고 세마포어에서 잔다. 상대는 head/tail 을
+   옮긴 뒤 *_waiting 이 서 있을 때만 깨운다. CPU 가 하나라서 인터럽트를
+   끈 확인-잠들기 사이에 상대가 끼어들 수 없으므로 깨움을 놓치지
+   않고, 아무도 기다리지 않으면 인터럽트도 끄지 않는다.
+
+   자던 스레드의 프로세스가 끝나는 중이면 (clone 한 다른 스레드가 죽은
+   경우) pipe_wake() 로 깨워지고 기다리지 않고 돌아간다. */
+
+#define PIPE_SIZE PGSIZE
+
+struct pipe {
+	uint8_t *buf;               /* PIPE_SIZE 바이트 링 */
+	size_t head;                /* 쓴 바이트 누계 */
+	size_t tail;                /* 읽은 바이트 누계 */
+	int readers;                /* 열린 읽기 끝 수 */
+	int writers;                /* 열린 쓰기 끝 수 */
+	bool reader_waiting;        /* 읽는 쪽이 readable 에서 잔다 */
+	bool writer_waiting;        /* 쓰는 쪽이 writable 에서 잔다 */
+	struct semaphore readable;
+	struct semaphore writable;
+	struct lock read_lock;
+	struct lock write_lock;
+};
+
+/* 읽기 끝과 쓰기 끝이 하나씩 열린 파이프를 만든다. 메모리가 없으면 NULL. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *p = malloc (sizeof *p);
+
+	if (p == NULL)
+		return NULL;
+	p->buf = palloc_get_page (0);
+	if (p->buf == NULL) {
+		free (p);
+		return NULL;
+	}
+	p->head = p->tail = 0;
+	p->readers = p->writers = 1;
+	p->reader_waiting = p->writer_waiting = false;
+	sema_init (&p->readable, 0);
+	sema_init (&p->writable, 0);
+	lock_init (&p->read_lock);
+	lock_init (&p->write_lock);
+	return p;
+}
+
+/* *WAITING 이 서 있으면 내리고 SEMA 에서 자는 쪽을 깨운다. */
+static void
+wake (bool *waiting, struct semaphore *sema) {
+	enum intr_level old_level;
+
+	if (!__atomic_load_n (waiting, __ATOMIC_SEQ_CST))
+		return;
+	old_level = intr_disable ();
+	if (*waiting) {
+		*waiting = false;
+		sema_up (sema);
+	}
+	intr_set_level (old_level);
+}
+
+/* 현재 스레드의 프로세스가 끝나는 중이라 더 기다리면 안 되는지. */
+static bool
+exiting (void) {
+	return thread_current ()->proc->group_exiting;
+}
+
+/* P 에서 읽거나 쓰려고 자는 쪽을 모두 깨운다. 프로세스가 끝날 때
+ * 파이프에서 자던 스레드가 깨어나 끝날 수 있게 한다. */
+void
+pipe_wake (struct pipe *p) {
+	wake (&p->reader_waiting, &p->readable);
+	wake (&p->writer_waiting, &p->writable);
+}
+
+/* P 의 WRITER 쪽 끝을 하나 더 연다 (fork). */
+void
+pipe_reopen (struct pipe *p, bool writer) {
+	enum intr_level old_level = intr_disable ();
+
+	if (writer)
+		p->writers++;
+	else
+		p->readers++;
+	intr_set_level (old_level);
+}
+
+/* P 의 WRITER 쪽 끝을 하나 닫는다. 그쪽 마지막 끝이면 기다리는 상대를
+ * 깨워 EOF 나 끊긴 파이프를 알게 하고, 양쪽 다 닫히면 파이프를 푼다. */
+void
+pipe_close (struct pipe *p, bool writer) {
+	enum intr_level old_level = intr_disable ();
+	bool last;
+
+	if (writer && --p->writers == 0)
+		wake (&p->reader_waiting, &p->readable);
+	if (!writer && --p->readers == 0)
+		wake (&p->writer_waiting, &p->writable);
+	last = p->readers == 0 && p->writers == 0;
+	intr_set_level (old_level);
+
+	if (last) {
+		palloc_free_page (p->buf);
+		free (p);
+	}
+}
+
+/* P 에서 SIZE 바이트까지 BUFFER 로 읽는다. 비어 있으면 데이터가 들어
+ * 오거나 쓰기 끝이 모두 닫힐 때까지 기다린다. 읽은 바이트 수를
+ * 돌려주고, 0 이면 EOF. */
+int
+pipe_read (struct pipe *p, void *buffer, size_t size) {
+	uint8_t *dst = buffer;
+	size_t head, n, ofs, first;
+
+	if (size == 0)
+		return 0;
+	lock_acquire (&p->read_lock);
+	head = __atomic_load_n (&p->head, __ATOMIC_ACQUIRE);
+	if (head == p->tail) {
+		enum intr_level old_level = intr_disable ();
+		while ((head = __atomic_load_n (&p->head, __ATOMIC_ACQUIRE)) == p->tail
+				&& p->writers > 0 && !exiting ()) {
+			p->reader_waiting = true;
+			sema_down (&p->readable);
+		}
+		intr_set_level (old_level);
+	}
+
+	n = head - p->tail < size ? head - p->tail : size;
+	ofs = p->tail % PIPE_SIZE;
+	first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+	memcpy (dst, p->buf + ofs, first);
+	memcpy (dst + first, p->buf, n - first);
+	__atomic_store_n (&p->tail, p->tail + n, __ATOMIC_RELEASE);
+	if (n > 0)
+		wake (&p->writer_waiting, &p->writable);
+	lock_release (&p->read_lock);
+	return n;
+}
+
+/* BUFFER 의 SIZE 바이트를 모두 P 에 쓴다. 꽉 차면 읽는 쪽이 비울 때까지
+ * 기다린다. 쓴 바이트 수를 돌려주고, 읽기 끝이 모두 닫혀서 하나도
+ * 못 썼으면 -1. */
+int
+pipe_write (struct pipe *p, const void *buffer, size_t size) {
+	const uint8_t *src = buffer;
+	size_t done = 0;
+
+	lock_acquire (&p->write_lock);
+	while (done < size) {
+		size_t tail = __atomic_load_n (&p->tail, __ATOMIC_ACQUIRE);
+		size_t n, ofs, first;
+
+		if (p->head - tail == PIPE_SIZE) {
+			enum intr_level old_level = intr_disable ();
+			while (p->head - (tail = __atomic_load_n (&p->tail, __ATOMIC_ACQUIRE))
+					== PIPE_SIZE && p->readers > 0 && !exiting ()) {
+				p->writer_waiting = true;
+				sema_down (&p->writable);
+			}
+			intr_set_level (old_level);
+		}
+		if (p->readers == 0 || p->head - tail == PIPE_SIZE)
+			break;
+
+		n = PIPE_SIZE - (p->head - tail);
+		if (n > size - done)
+			n = size - done;
+		ofs = p->head % PIPE_SIZE;
+		first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+		memcpy (p->buf + ofs, src + done, first);
+		memcpy (p->buf, src + done + first, n - first);
+		__atomic_store_n (&p->head, p->head + n, __ATOMIC_RELEASE);
+		done += n;
+		wake (&p->reader_waiting, &p->readable);
+	}
+	lock_release (&p->write_lock);
+	return done > 0 || size == 0 ? (int) done : -1;
+}
@@ -1,9 +1,13 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
+struct pipe;
+
+void file_init (void);
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
@@ -12,6 +16,12 @@ struct file *file_duplicate (struct file *file);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
 
+/* Pipe ends and shared descriptors. */
+struct file *file_open_pipe (struct pipe *, bool writer);
+struct file *file_dup (struct file *);
+struct pipe *file_get_pipe (struct file *, bool writer);
+bool file_is_pipe (struct file *);
+
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
@@ -0,0 +1,18 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 프로세스 사이 바이트 스트림. pipe.c 참고. 유저에게는 file.c 의
+ * 파이프 끝(struct file) 으로 fd 테이블에 들어간다. */
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_reopen (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *buffer, size_t size);
+int pipe_write (struct pipe *, const void *buffer, size_t size);
+void pipe_wake (struct pipe *);
+
+#endif /* filesys/pipe.h */
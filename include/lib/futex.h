@@ -0,0 +1,8 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* futex() 의 OP. */
+#define FUTEX_WAIT 0        /* *ADDR == VAL 이면 깨워질 때까지 잔다 */
+#define FUTEX_WAKE 1        /* ADDR 에서 자는 스레드를 VAL 개까지 깨운다 */
+
+#endif /* lib/futex.h */
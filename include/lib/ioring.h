@@ -0,0 +1,52 @@
+#ifndef __LIB_IORING_H
+#define __LIB_IORING_H
+
+#include <stdint.h>
+
+/* 시스템 콜 묶음 처리용 제출/완료 링.
+
+   유저 프로그램이 자기 메모리에 struct io_ring 을 두고 ring_setup()
+   으로 등록한다. sq 에 요청을 채우고 sq_tail 을 올린 뒤 ring_enter()
+   를 한 번 부르면 커널이 sq_head 부터 차례로 처리하고 결과를 cq 에
+   올리며 cq_tail 을 올린다. 유저는 cq_head 부터 읽고 cq_head 를
+   올린다. head/tail 은 계속 늘어나는 수이고 칸 번호는
+   IORING_ENTRIES 로 나눈 나머지다. */
+
+#define IORING_ENTRIES 32           /* sq, cq 칸 수 */
+
+/* 요청 종류 */
+enum {
+	IORING_OP_NOP,                  /* 아무것도 하지 않는다 */
+	IORING_OP_READ,                 /* read, off >= 0 이면 pread */
+	IORING_OP_WRITE,                /* write, off >= 0 이면 pwrite */
+	IORING_OP_OPEN,                 /* open (addr 은 파일 이름) */
+	IORING_OP_CLOSE,                /* close */
+};
+
+/* 제출 큐 항목 */
+struct io_sqe {
+	uint32_t opcode;                /* IORING_OP_* */
+	int32_t fd;
+	uint64_t addr;                  /* 버퍼 또는 파일 이름 */
+	uint32_t len;
+	int32_t off;                    /* 파일 위치. -1 이면 현재 위치 */
+	uint64_t user_data;             /* 완료 항목에 그대로 돌려준다 */
+};
+
+/* 완료 큐 항목 */
+struct io_cqe {
+	uint64_t user_data;
+	int32_t res;                    /* 해당 시스템 콜의 반환값 */
+	uint32_t pad;
+};
+
+struct io_ring {
+	uint32_t sq_head;               /* 커널이 올린다 */
+	uint32_t sq_tail;               /* 유저가 올린다 */
+	uint32_t cq_head;               /* 유저가 올린다 */
+	uint32_t cq_tail;               /* 커널이 올린다 */
+	struct io_sqe sq[IORING_ENTRIES];
+	struct io_cqe cq[IORING_ENTRIES];
+};
+
+#endif /* lib/ioring.h */
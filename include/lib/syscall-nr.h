@@ -36,6 +36,22 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* 추가 파일 입출력 */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_PREAD,                  /* Read at a given file offset. */
+	SYS_PWRITE,                 /* Write at a given file offset. */
+	SYS_COPY_FILE_RANGE,        /* Copy between files inside the kernel. */
+	SYS_RING_SETUP,             /* Register a submission/completion ring. */
+	SYS_RING_ENTER,             /* Process queued ring requests. */
+	SYS_SYSCALL_STAT,           /* Read per-syscall statistics. */
+	SYS_TRACE_CTL,              /* Turn syscall tracing on or off. */
+	SYS_TRACE_READ,             /* Read syscall trace records. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_FUTEX,                  /* Wait or wake on a user-space word. */
+	SYS_CLONE,                  /* Start a thread in this address space. */
+	SYS_JOIN,                   /* Wait for a cloned thread to exit. */
 };
 
 #endif /* lib/syscall-nr.h */
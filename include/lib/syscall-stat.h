@@ -0,0 +1,20 @@
+#ifndef __LIB_SYSCALL_STAT_H
+#define __LIB_SYSCALL_STAT_H
+
+#include <stdint.h>
+
+/* 시스템 콜 하나의 누적 통계. syscall_stat() 으로 읽는다.
+
+   hist[i] 는 걸린 시간이 [2^i, 2^(i+1)) TSC 사이클인 호출 수이고
+   마지막 칸은 그보다 오래 걸린 호출까지 센다. exit, 성공한 exec,
+   halt 처럼 돌아오지 않는 호출은 calls 에만 들어간다. */
+#define SYSCALL_HIST_BUCKETS 32
+
+struct syscall_stat {
+	uint64_t calls;             /* 부른 횟수 */
+	uint64_t errors;            /* 실패를 돌려준 횟수 */
+	uint64_t cycles;            /* 돌아온 호출들의 총 사이클 */
+	uint64_t hist[SYSCALL_HIST_BUCKETS];
+};
+
+#endif /* lib/syscall-stat.h */
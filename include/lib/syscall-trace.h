@@ -0,0 +1,22 @@
+#ifndef __LIB_SYSCALL_TRACE_H
+#define __LIB_SYSCALL_TRACE_H
+
+#include <stdint.h>
+
+/* 시스템 콜 trace 기록 하나. trace_read() 로 읽는다.
+
+   seq 는 커널 버퍼 전체에서 매긴 1 부터의 번호라서 건너뛴 번호가
+   있으면 그만큼 읽기 전에 덮어쓰인 것이다. 돌아오지 않는 호출
+   (exit, 성공한 exec, halt) 은 기록되지 않는다. */
+#define TRACE_ARGS 5
+
+struct trace_rec {
+	uint64_t seq;
+	int32_t tid;
+	uint32_t nr;                /* SYS_* */
+	uint64_t args[TRACE_ARGS];  /* rdi, rsi, rdx, r10, r8 */
+	uint64_t ret;               /* rax 로 돌려준 값 */
+	uint64_t cycles;            /* 걸린 TSC 사이클 */
+};
+
+#endif /* lib/syscall-trace.h */
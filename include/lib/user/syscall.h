@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,6 +38,40 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int pipe (int fds[2]);
+
+/* 유저 락. OP 는 <futex.h> 참고. */
+int futex (uint32_t *addr, int op, uint32_t val);
+
+/* 같은 주소 공간과 fd 테이블에서 FN (ARG) 를 도는 스레드를 STACK
+ * 꼭대기에서 시작한다. FN 이 돌려준 값은 join 으로 받는다. */
+pid_t clone (int (*fn) (void *), void *arg, void *stack);
+int join (pid_t);
+
+/* 여러 버퍼를 한 번에 읽고 쓰기 */
+struct iovec {
+	void *iov_base;             /* 버퍼 시작 */
+	size_t iov_len;             /* 버퍼 길이 */
+};
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+
+/* 시스템 콜 묶음 처리. <ioring.h> 참고. */
+struct io_ring;
+int ring_setup (struct io_ring *ring);
+int ring_enter (unsigned to_submit);
+
+/* 시스템 콜 통계. <syscall-stat.h> 참고. */
+struct syscall_stat;
+int syscall_stat (int nr, struct syscall_stat *st);
+
+/* 시스템 콜 trace. <syscall-trace.h> 참고. */
+struct trace_rec;
+int trace_ctl (pid_t pid, bool on);
+int trace_read (struct trace_rec *buf, unsigned cnt);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
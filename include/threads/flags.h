@@ -9,4 +9,7 @@
 #define FLAG_AC    (1<<18)
 #define FLAG_NT    (1<<14)
 
+/* CR0 */
+#define CR0_WP     (1<<16)      /* Write-Protect enable in kernel mode. */
+
 #endif /* threads/flags.h */
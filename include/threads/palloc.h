@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -19,5 +20,9 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_extend_multiple (void *, size_t page_cnt, size_t extra);
+size_t palloc_free_cnt (enum palloc_flags);
+size_t palloc_pool_size (enum palloc_flags);
+bool palloc_zero_idle (void);
 
 #endif /* threads/palloc.h */
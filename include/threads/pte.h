@@ -41,5 +41,12 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2MB page (PDEs only). */
+#define PTE_G 0x100                      /* 1=global, kept across CR3 loads. */
+
+/* A PDE with PTE_PS set maps a 2MB page directly. */
+#define HUGE_PGSIZE (1UL << PDXSHIFT)
+#define HUGE_PGMASK (HUGE_PGSIZE - 1)
+#define HUGE_PGCNT (HUGE_PGSIZE / PGSIZE)
 
 #endif /* threads/pte.h */
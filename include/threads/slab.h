@@ -0,0 +1,23 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 같은 크기 객체 전용 캐시. slab.c 참고. */
+struct kmem_cache;
+
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		size_t align, kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *obj);
+void kmem_cache_self_test (struct kmem_cache *);
+
+/* malloc.c 의 free()/realloc() 이 slab 객체를 알아보는 데 쓴다. */
+bool kmem_owns (const void *obj);
+size_t kmem_obj_size (const void *obj);
+void kmem_free (void *obj);
+
+#endif /* threads/slab.h */
@@ -30,6 +30,9 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* struct thread 안에 바로 두는 fd 수. 넘치면 fd_table 을 힙으로 옮긴다. */
+#define FD_INLINE 16
+
 // #define USERPROG
 
 /* A kernel thread or user process.
@@ -105,6 +108,8 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	void *stack_bottom;                 /* 현재 유저 스택의 가장 낮은 페이지 */
+	uintptr_t user_rsp;                 /* 시스템 콜 진입 시점의 유저 rsp */
 #endif
 
 	/* Owned by thread.c. */
@@ -128,12 +133,26 @@ struct thread {
 	int nice;					//나이스한 녀석 nice지수가 높으면(양수) 양보 잘함 낮으면(음수) 양보 못함
 	real recent_cpu;			//최근에 CPU얼마나 썼는지 많이 쓰면 쓸 수록
 	int exit_status;
-	unsigned fd;				//파일디스크립터 == idx
 	struct file **fd_table;//파일을 담고있는 파일디스크립터 테이블
+	unsigned fd_cap;                    /* fd_table 칸 수 */
+	uint64_t *fd_map;                   /* 쓰는 fd 비트맵 (0, 1 은 항상 1) */
+	uint64_t fd_inline_map;             /* 처음 fd_map */
+	struct file *fd_inline[FD_INLINE];  /* 처음 fd_table */
+	struct io_ring *io_ring;            /* ring_setup 으로 등록한 유저 링 */
+	bool trace;                         /* 시스템 콜을 trace 버퍼에 기록 */
+	uint8_t *bounce;                    /* read/write 가 유저 버퍼를 옮겨 담는 페이지 */
 
 	struct intr_frame *pre_if; //이전 if정보
 	struct file *running_file;
 	struct list child_list;
+
+	/* clone 으로 만든 스레드는 proc 의 주소 공간(pml4, spt)과 fd 테이블을
+	 * 같이 쓴다. 보통 스레드는 proc 이 자기 자신이다. */
+	struct thread *proc;                /* 주소 공간과 fd 테이블의 주인 */
+	struct list clone_list;             /* proc 일 때, 아직 거두지 않은 clone 들 */
+	struct lock fd_lock;                /* proc 일 때, fd 테이블을 지킨다 */
+	bool group_exiting;                 /* proc 일 때, 모든 스레드가 끝나는 중 */
+	int group_status;                   /* proc 일 때, 프로세스의 exit status */
 };
 
 
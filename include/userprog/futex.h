@@ -0,0 +1,14 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+struct thread;
+
+/* 유저 락을 위한 대기 큐. futex.c 참고. */
+void futex_init (void);
+int futex_wait (uint32_t *uaddr, uint32_t val);
+int futex_wake (uint32_t *uaddr, uint32_t cnt);
+void futex_wake_group (struct thread *proc);
+
+#endif /* userprog/futex.h */
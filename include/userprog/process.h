@@ -7,6 +7,11 @@ tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
 int process_wait (tid_t);
+tid_t process_clone (const struct intr_frame *if_, uintptr_t entry,
+		uint64_t arg0, uint64_t arg1, uintptr_t stack);
+int process_join (tid_t);
+void process_group_exit (struct thread *proc, int status);
+void process_check_exit (void);
 void process_exit (void);
 void process_activate (struct thread *next);
 
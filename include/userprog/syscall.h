@@ -1,7 +1,16 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct thread;
+
 void syscall_init (void);
+bool fd_table_copy (struct thread *dst, struct thread *src);
+void fd_table_destroy (struct thread *);
+void fd_table_wake_pipes (struct thread *);
+void syscall_print_stats (void);
+void sys_exit (int status);
 
 struct lock filesys_lock;
 
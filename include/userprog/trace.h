@@ -0,0 +1,14 @@
+#ifndef USERPROG_TRACE_H
+#define USERPROG_TRACE_H
+
+#include <stdint.h>
+#include <syscall-trace.h>
+#include "threads/interrupt.h"
+
+/* 시스템 콜 trace 버퍼. trace.c 참고. */
+void trace_init (void);
+void trace_log (int tid, unsigned nr, const struct intr_frame *f,
+		uint64_t ret, uint64_t cycles);
+int trace_read (struct trace_rec *ubuf, unsigned cnt);
+
+#endif /* userprog/trace.h */
@@ -0,0 +1,18 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 유저 메모리 복사. 잘못된 유저 주소에서 폴트가 나면 uaccess-copy.S
+ * 의 예외 테이블을 보고 실패로 돌아온다. uaccess.c 참고. */
+bool uaccess_ok (const void *uaddr, size_t size);
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+long strncpy_from_user (char *dst, const char *usrc, size_t size);
+bool touch_user_write (uint32_t *uaddr);
+
+uintptr_t search_exception_table (uintptr_t rip);
+
+#endif /* userprog/uaccess.h */
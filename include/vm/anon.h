@@ -1,13 +1,17 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
 struct anon_page {
+	size_t swap_slot;             /* 스왑 디스크 슬롯, 없으면 BITMAP_ERROR */
+	bool zero_mapped;             /* 공유 zero 프레임을 읽기 전용으로 매핑 중 */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_map_zero (struct page *page);
 
 #endif
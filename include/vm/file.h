@@ -1,12 +1,34 @@
 #ifndef VM_FILE_H
 #define VM_FILE_H
+#include <list.h>
 #include "filesys/file.h"
 #include "vm/vm.h"
 
 struct page;
 enum vm_type;
 
+struct file_share;
+
 struct file_page {
+	struct file *file;            /* 이 페이지 전용으로 연 파일 */
+	off_t ofs;                    /* 파일 안 위치 */
+	size_t read_bytes;            /* 파일에서 읽는 바이트 수 */
+	size_t zero_bytes;            /* 나머지 0 으로 채울 바이트 수 */
+	void *map_addr;               /* 이 페이지가 속한 mmap 의 시작 주소 */
+	struct file_share *share;     /* 같이 쓰는 프레임, 안 올라와 있으면 NULL */
+	struct list_elem share_elem;  /* file_share 의 pages 원소 */
+};
+
+/* 파일에서 내용을 읽어오는 uninit 페이지의 aux.
+ * 페이지마다 자기 file 을 들고 있고, 로드가 끝나거나 페이지가
+ * 없어질 때 닫는다. */
+struct lazy_load_info {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	size_t zero_bytes;
+	void *map_addr;               /* mmap 시작 주소, 실행 파일이면 NULL */
+	bool prefilled;               /* fault-around 가 프레임에 미리 읽어 둠 */
 };
 
 void vm_file_init (void);
@@ -14,4 +36,5 @@ bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool file_backed_share (struct page *page);
 #endif
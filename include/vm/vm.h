@@ -1,7 +1,10 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -24,6 +27,11 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* 스택 페이지 표시 */
+#define VM_STACK VM_MARKER_0
+/* 파일에서 내용을 읽어오는 페이지(실행 파일 세그먼트, mmap) 표시 */
+#define VM_FILE_LOAD VM_MARKER_1
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -46,6 +54,9 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	struct hash_elem hash_elem;   /* spt 해시 테이블 원소 */
+	uint64_t *pml4;               /* 이 페이지가 매핑되는 페이지 테이블 */
+	bool writable;                /* 쓰기 가능 여부 */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -63,6 +74,10 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+	struct list_elem frame_elem;  /* 프레임 테이블 원소 */
+	int pin_cnt;                  /* 0 이 아니면 쫓아내지 않는다 */
+	bool evicting;                /* 쫓아내는 중 */
+	bool dead;                    /* 페이지가 사라짐. 마지막 고정이 풀리면 돌려준다 */
 };
 
 /* The function table for page operations.
@@ -85,6 +100,8 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+	struct hash pages;            /* va -> struct page */
+	struct lock lock;             /* clone 한 스레드들이 같이 쓸 때 폴트, mmap 을 막는다 */
 };
 
 #include "threads/thread.h"
@@ -97,6 +114,9 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+/* 유저 스택이 자랄 수 있는 최대 페이지 수. */
+extern size_t stack_page_limit;
+
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
@@ -107,6 +127,11 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+struct frame *vm_hold_frame (struct page *page);
+void vm_free_frame (struct page *page);
+void vm_detach_frame (struct page *page, struct page *heir);
+void *vm_pin_user (void *va, struct frame **framep);
+void vm_unpin_frame (struct frame *frame);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -145,6 +145,82 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned length) {
+	return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, length);
+}
+
+int
+ring_setup (struct io_ring *ring) {
+	return syscall1 (SYS_RING_SETUP, ring);
+}
+
+int
+ring_enter (unsigned to_submit) {
+	return syscall1 (SYS_RING_ENTER, to_submit);
+}
+
+int
+syscall_stat (int nr, struct syscall_stat *st) {
+	return syscall2 (SYS_SYSCALL_STAT, nr, st);
+}
+
+int
+trace_ctl (pid_t pid, bool on) {
+	return syscall2 (SYS_TRACE_CTL, pid, on);
+}
+
+int
+trace_read (struct trace_rec *buf, unsigned cnt) {
+	return syscall2 (SYS_TRACE_READ, buf, cnt);
+}
+
+int
+pipe (int fds[2]) {
+	return syscall1 (SYS_PIPE, fds);
+}
+
+int
+futex (uint32_t *addr, int op, uint32_t val) {
+	return syscall3 (SYS_FUTEX, addr, op, val);
+}
+
+/* clone 한 스레드가 처음 도는 곳. FN 이 돌아오면 그 값으로 스레드를 끝낸다. */
+static void
+clone_start (int (*fn) (void *), void *arg) {
+	exit (fn (arg));
+}
+
+pid_t
+clone (int (*fn) (void *), void *arg, void *stack) {
+	return syscall4 (SYS_CLONE, clone_start, fn, arg, stack);
+}
+
+int
+join (pid_t tid) {
+	return syscall1 (SYS_JOIN, tid);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -0,0 +1,38 @@
+/* Creates slab caches of several object sizes, including objects
+   too big to fit more than a few per page and a cache with a
+   constructor, and checks with kmem_cache_self_test() that each one
+   hands out aligned, non-overlapping objects from its own slabs
+   across more than one slab. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+
+/* 생성자가 있는 캐시용. 내용은 self-test 가 덮지 않는다. */
+static void
+fill (void *obj) 
+{
+  memset (obj, 0xcc, 40);
+}
+
+void
+test_slab_basic (void) 
+{
+  static const size_t sizes[] = {1, 8, 24, 100, 544, 1000, 2000};
+  struct kmem_cache *c;
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      c = kmem_cache_create ("slab-basic", sizes[i], 0, NULL);
+      ASSERT (c != NULL);
+      kmem_cache_self_test (c);
+      msg ("size %zu ok", sizes[i]);
+    }
+
+  c = kmem_cache_create ("slab-basic-ctor", 40, 0, fill);
+  ASSERT (c != NULL);
+  kmem_cache_self_test (c);
+  pass ();
+}
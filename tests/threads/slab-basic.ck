@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-basic) begin
+(slab-basic) size 1 ok
+(slab-basic) size 8 ok
+(slab-basic) size 24 ok
+(slab-basic) size 100 ok
+(slab-basic) size 544 ok
+(slab-basic) size 1000 ok
+(slab-basic) size 2000 ok
+(slab-basic) PASS
+(slab-basic) end
+EOF
+pass;
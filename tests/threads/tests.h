@@ -22,6 +22,7 @@ extern test_func test_priority_donate_chain;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
+extern test_func test_slab_basic;
 extern test_func test_priority_condvar;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
@@ -0,0 +1,85 @@
+/* A fault in any clone() thread ends the whole process, and the
+   owner's exit() does not wait forever for threads that are
+   still spinning, sleeping in futex(), or blocked on a pipe. */
+
+#include <debug.h>
+#include <futex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char stacks[3][4096] __attribute__ ((aligned (16)));
+static uint32_t word;
+static int fds[2];
+
+static int
+spin (void *arg UNUSED) 
+{
+  for (;;)
+    continue;
+  NOT_REACHED ();
+}
+
+static int
+sleep_futex (void *arg UNUSED) 
+{
+  futex (&word, FUTEX_WAIT, 0);
+  return 0;
+}
+
+static int
+read_pipe (void *arg UNUSED) 
+{
+  char c;
+
+  read (fds[0], &c, 1);
+  return 0;
+}
+
+static int
+crash (void *arg UNUSED) 
+{
+  *(volatile int *) NULL = 0;
+  return 0;
+}
+
+/* 끝나지 않는 스레드 둘을 띄운다. */
+static void
+start_stuck_threads (void) 
+{
+  if (clone (spin, NULL, stacks[0] + sizeof stacks[0]) == PID_ERROR
+      || clone (sleep_futex, NULL, stacks[1] + sizeof stacks[1]) == PID_ERROR)
+    exit (1);
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  if ((pid = fork ("crash")) == 0)
+    {
+      start_stuck_threads ();
+      clone (crash, NULL, stacks[2] + sizeof stacks[2]);
+      for (;;)
+        futex (&word, FUTEX_WAIT, 0);
+    }
+  CHECK (wait (pid) == -1, "fault in a thread ended the process");
+
+  if ((pid = fork ("exit")) == 0)
+    {
+      start_stuck_threads ();
+      exit (5);
+    }
+  CHECK (wait (pid) == 5, "exit with threads still running");
+
+  if ((pid = fork ("pipe")) == 0)
+    {
+      if (pipe (fds) < 0)
+        exit (1);
+      start_stuck_threads ();
+      clone (read_pipe, NULL, stacks[2] + sizeof stacks[2]);
+      exit (7);
+    }
+  CHECK (wait (pid) == 7, "exit with a thread blocked on a pipe");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(clone-exit) begin
+crash: exit(-1)
+(clone-exit) fault in a thread ended the process
+exit: exit(5)
+(clone-exit) exit with threads still running
+pipe: exit(7)
+(clone-exit) exit with a thread blocked on a pipe
+(clone-exit) end
+clone-exit: exit(0)
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Starts threads with clone() that share the caller's memory and
+   file descriptors, and collects their return values with join(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define N 1000
+
+static int numbers[N];
+static long sums[2];
+static char stacks[3][4096] __attribute__ ((aligned (16)));
+
+/* ARG 가 가리키는 절반의 합을 sums 에 쓴다. */
+static int
+sum_half (void *arg) 
+{
+  int half = (int) (long) arg;
+  long sum = 0;
+  int i;
+
+  for (i = half * N / 2; i < (half + 1) * N / 2; i++)
+    sum += numbers[i];
+  sums[half] = sum;
+  return half + 10;
+}
+
+/* 파일을 만들어 열고 그 fd 를 돌려준다. */
+static int
+open_file (void *arg UNUSED) 
+{
+  if (!create ("shared", 0))
+    return -1;
+  return open ("shared");
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[3];
+  int i, fd;
+
+  for (i = 0; i < N; i++)
+    numbers[i] = i + 1;
+
+  for (i = 0; i < 2; i++)
+    {
+      tids[i] = clone (sum_half, (void *) (long) i,
+                       stacks[i] + sizeof stacks[i]);
+      CHECK (tids[i] != PID_ERROR, "clone thread %d", i);
+    }
+  for (i = 0; i < 2; i++)
+    CHECK (join (tids[i]) == i + 10, "join thread %d", i);
+  CHECK (sums[0] + sums[1] == (long) N * (N + 1) / 2,
+         "threads summed shared array");
+  CHECK (join (tids[0]) == -1, "second join fails");
+
+  tids[2] = clone (open_file, NULL, stacks[2] + sizeof stacks[2]);
+  fd = join (tids[2]);
+  CHECK (fd > 1, "thread opened a file");
+  CHECK (write (fd, "abc", 3) == 3, "fd is shared with the thread");
+  CHECK (filesize (fd) == 3, "filesize is 3");
+  close (fd);
+}
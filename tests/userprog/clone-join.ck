@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clone-join) begin
+(clone-join) clone thread 0
+(clone-join) clone thread 1
+(clone-join) join thread 0
+(clone-join) join thread 1
+(clone-join) threads summed shared array
+(clone-join) second join fails
+(clone-join) thread opened a file
+(clone-join) fd is shared with the thread
+(clone-join) filesize is 3
+(clone-join) end
+clone-join: exit(0)
+EOF
+pass;
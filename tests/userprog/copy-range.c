@@ -0,0 +1,28 @@
+/* Copies sample.txt into a new file with copy_file_range()
+   in two steps and verifies the copy and both file positions. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int size = sizeof sample - 1;
+  int in, out;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (copy_file_range (in, out, 100) == 100, "copy 100 bytes");
+  CHECK (copy_file_range (in, out, 4096) == size - 100, "copy the rest");
+  CHECK (tell (in) == (unsigned) size && tell (out) == (unsigned) size,
+         "both positions at end of file");
+  CHECK (copy_file_range (in, in, 10) == -1, "copy within one file fails");
+
+  close (in);
+  close (out);
+  check_file ("test.txt", sample, size);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) create "test.txt"
+(copy-range) open "sample.txt"
+(copy-range) open "test.txt"
+(copy-range) copy 100 bytes
+(copy-range) copy the rest
+(copy-range) both positions at end of file
+(copy-range) copy within one file fails
+(copy-range) open "test.txt" for verification
+(copy-range) verified contents of "test.txt"
+(copy-range) close "test.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
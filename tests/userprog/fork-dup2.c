@@ -0,0 +1,33 @@
+/* Makes a second fd for sample.txt with dup2, then forks. The
+   child reads through both fds in turn and must see one shared
+   file position, as the parent would. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK 10
+
+void
+test_main (void) 
+{
+  char buf[CHUNK * 2];
+  int fd, fd2;
+  pid_t pid;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((fd2 = dup2 (fd, fd + 10)) == fd + 10, "dup2");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      if (read (fd, buf, CHUNK) != CHUNK
+          || read (fd2, buf + CHUNK, CHUNK) != CHUNK)
+        exit (1);
+      if (memcmp (buf, sample, sizeof buf))
+        exit (2);
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "child shared one position across both fds");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-dup2) begin
+(fork-dup2) open "sample.txt"
+(fork-dup2) dup2
+child: exit(0)
+(fork-dup2) child shared one position across both fds
+(fork-dup2) end
+fork-dup2: exit(0)
+EOF
+pass;
@@ -0,0 +1,24 @@
+/* Checks the non-sleeping paths of futex(): waiting on a value
+   that already changed, waking with nobody asleep, and bad
+   arguments. */
+
+#include <futex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static uint32_t word = 5;
+
+void
+test_main (void) 
+{
+  CHECK (futex (&word, FUTEX_WAIT, 4) == -1,
+         "wait on a changed value returns at once");
+  CHECK (futex (&word, FUTEX_WAKE, 1) == 0, "wake with nobody waiting");
+  CHECK (futex ((uint32_t *) ((char *) &word + 1), FUTEX_WAKE, 1) == -1,
+         "misaligned address rejected");
+  CHECK (futex ((uint32_t *) 0xc0000000, FUTEX_WAKE, 1) == -1,
+         "unmapped address rejected");
+  CHECK (futex (&word, 7, 0) == -1, "unknown op rejected");
+  CHECK (word == 5, "word unchanged");
+}
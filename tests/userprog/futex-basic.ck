@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-basic) begin
+(futex-basic) wait on a changed value returns at once
+(futex-basic) wake with nobody waiting
+(futex-basic) misaligned address rejected
+(futex-basic) unmapped address rejected
+(futex-basic) unknown op rejected
+(futex-basic) word unchanged
+(futex-basic) end
+futex-basic: exit(0)
+EOF
+pass;
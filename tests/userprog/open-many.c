@@ -0,0 +1,38 @@
+/* Opens more files than the old 128-entry fd table could hold,
+   checks that each open gets the next lowest fd, and that the
+   lowest freed fd is handed out again after a close. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+void
+test_main (void) 
+{
+  static int fds[FILE_CNT];
+  char buf[16];
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+      if (i > 0 && fds[i] != fds[i - 1] + 1)
+        fail ("open #%d returned %d, expected %d", i, fds[i], fds[i - 1] + 1);
+    }
+  msg ("opened \"sample.txt\" %d times", FILE_CNT);
+
+  CHECK (read (fds[FILE_CNT - 1], buf, sizeof buf) == sizeof buf,
+         "read from the last fd");
+
+  msg ("close two fds");
+  close (fds[150]);
+  close (fds[20]);
+  CHECK (open ("sample.txt") == fds[20], "reopen gets the lower freed fd");
+  CHECK (open ("sample.txt") == fds[150], "reopen gets the next freed fd");
+  CHECK (open ("sample.txt") == fds[FILE_CNT - 1] + 1,
+         "reopen past the table gets a new fd");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 200 times
+(open-many) read from the last fd
+(open-many) close two fds
+(open-many) reopen gets the lower freed fd
+(open-many) reopen gets the next freed fd
+(open-many) reopen past the table gets a new fd
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* The child writes sample.txt's text into a pipe several times
+   through its standard output (dup2), more than the pipe holds
+   at once. The parent reads until EOF and checks every byte. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 20
+
+static char buf[ROUNDS * sizeof sample];
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int fds[2];
+  int total = 0, n, i;
+  pid_t pid;
+
+  CHECK (pipe (fds) == 0 && fds[0] > 1 && fds[1] > 1, "pipe");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      close (fds[0]);
+      if (dup2 (fds[1], 1) != 1)
+        exit (1);
+      close (fds[1]);
+      for (i = 0; i < ROUNDS; i++)
+        if (write (1, sample, size) != (int) size)
+          exit (2);
+      exit (0);
+    }
+
+  close (fds[1]);
+  while ((n = read (fds[0], buf + total, sizeof buf - total)) > 0)
+    total += n;
+  if (total != (int) (ROUNDS * size))
+    fail ("read %d bytes instead of %zu", total, ROUNDS * size);
+  for (i = 0; i < ROUNDS; i++)
+    if (memcmp (buf + i * size, sample, size))
+      fail ("round %d differs from sample", i);
+  msg ("read everything the child wrote");
+  CHECK (read (fds[0], buf, 1) == 0, "read at EOF returns 0");
+  CHECK (wait (pid) == 0, "wait for child");
+  close (fds[0]);
+}
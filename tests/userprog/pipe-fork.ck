@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-fork) begin
+(pipe-fork) pipe
+child: exit(0)
+(pipe-fork) read everything the child wrote
+(pipe-fork) read at EOF returns 0
+(pipe-fork) wait for child
+(pipe-fork) end
+pipe-fork: exit(0)
+EOF
+pass;
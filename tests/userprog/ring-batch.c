@@ -0,0 +1,67 @@
+/* Opens sample.txt through an I/O ring, then reads it in two
+   positioned reads and closes it in a single ring_enter(),
+   and verifies every completion. */
+
+#include <ioring.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct io_ring ring;
+static char buf[sizeof sample];
+
+static void
+submit (uint32_t opcode, int fd, void *addr, uint32_t len, int off,
+        uint64_t user_data)
+{
+  struct io_sqe *sqe = &ring.sq[ring.sq_tail % IORING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) addr;
+  sqe->len = len;
+  sqe->off = off;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+static struct io_cqe *
+reap (void)
+{
+  return &ring.cq[ring.cq_head++ % IORING_ENTRIES];
+}
+
+void
+test_main (void) 
+{
+  int size = sizeof sample - 1;
+  struct io_cqe *cqe;
+  int fd;
+
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  submit (IORING_OP_OPEN, 0, "sample.txt", 0, 0, 1);
+  submit (IORING_OP_NOP, 0, NULL, 0, 0, 2);
+  CHECK (ring_enter (2) == 2, "submit open and nop");
+  cqe = reap ();
+  fd = cqe->res;
+  CHECK (cqe->user_data == 1 && fd > 1, "open completed");
+  cqe = reap ();
+  CHECK (cqe->user_data == 2 && cqe->res == 0, "nop completed");
+
+  submit (IORING_OP_READ, fd, buf + 100, size - 100, 100, 3);
+  submit (IORING_OP_READ, fd, buf, 100, 0, 4);
+  submit (IORING_OP_CLOSE, fd, NULL, 0, 0, 5);
+  CHECK (ring_enter (3) == 3, "submit two reads and close");
+  cqe = reap ();
+  CHECK (cqe->user_data == 3 && cqe->res == size - 100, "tail read completed");
+  cqe = reap ();
+  CHECK (cqe->user_data == 4 && cqe->res == 100, "head read completed");
+  cqe = reap ();
+  CHECK (cqe->user_data == 5 && cqe->res == 0, "close completed");
+  CHECK (ring.sq_head == ring.sq_tail && ring.cq_head == ring.cq_tail,
+         "ring drained");
+  CHECK (!memcmp (buf, sample, size), "data matches sample");
+}
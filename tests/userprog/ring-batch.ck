@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) ring_setup
+(ring-batch) submit open and nop
+(ring-batch) open completed
+(ring-batch) nop completed
+(ring-batch) submit two reads and close
+(ring-batch) tail read completed
+(ring-batch) head read completed
+(ring-batch) close completed
+(ring-batch) ring drained
+(ring-batch) data matches sample
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
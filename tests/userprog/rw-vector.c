@@ -0,0 +1,45 @@
+/* Writes sample.txt's contents into a new file with writev(),
+   reads them back with pread() and readv(), and checks that
+   pread() and pwrite() leave the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  char expected[sizeof sample];
+  struct iovec iov[3];
+  int size = sizeof sample - 1;
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0] = (struct iovec) { sample, 10 };
+  iov[1] = (struct iovec) { sample + 10, 0 };
+  iov[2] = (struct iovec) { sample + 10, size - 10 };
+  CHECK (writev (handle, iov, 3) == size, "writev \"test.txt\"");
+  CHECK (tell (handle) == (unsigned) size, "tell \"test.txt\" after writev");
+
+  memset (buf, 0, sizeof buf);
+  CHECK (pread (handle, buf, size, 0) == size, "pread \"test.txt\"");
+  compare_bytes (buf, sample, size, 0, "test.txt");
+  CHECK (tell (handle) == (unsigned) size, "tell \"test.txt\" after pread");
+
+  CHECK (pwrite (handle, "kaist", 5, 1) == 5, "pwrite \"test.txt\"");
+  CHECK (tell (handle) == (unsigned) size, "tell \"test.txt\" after pwrite");
+
+  memcpy (expected, sample, size);
+  memcpy (expected + 1, "kaist", 5);
+  memset (buf, 0, sizeof buf);
+  seek (handle, 0);
+  iov[0] = (struct iovec) { buf, 7 };
+  iov[1] = (struct iovec) { buf + 7, size - 7 };
+  CHECK (readv (handle, iov, 2) == size, "readv \"test.txt\"");
+  compare_bytes (buf, expected, size, 0, "test.txt");
+}
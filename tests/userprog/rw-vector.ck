@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-vector) begin
+(rw-vector) create "test.txt"
+(rw-vector) open "test.txt"
+(rw-vector) writev "test.txt"
+(rw-vector) tell "test.txt" after writev
+(rw-vector) pread "test.txt"
+(rw-vector) tell "test.txt" after pread
+(rw-vector) pwrite "test.txt"
+(rw-vector) tell "test.txt" after pwrite
+(rw-vector) readv "test.txt"
+(rw-vector) end
+rw-vector: exit(0)
+EOF
+pass;
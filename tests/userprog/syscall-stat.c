@@ -0,0 +1,39 @@
+/* Checks that syscall_stat() counts calls, failures and timed
+   returns of open(), and that tell() returns its result. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include <syscall-stat.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static uint64_t
+timed (const struct syscall_stat *st)
+{
+  uint64_t sum = 0;
+  int i;
+
+  for (i = 0; i < SYSCALL_HIST_BUCKETS; i++)
+    sum += st->hist[i];
+  return sum;
+}
+
+void
+test_main (void) 
+{
+  struct syscall_stat before, after;
+  int fd;
+
+  CHECK (syscall_stat (SYS_OPEN, &before) == 0, "stat open");
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (open ("no-such-file") == -1, "open \"no-such-file\"");
+  CHECK (syscall_stat (SYS_OPEN, &after) == 0, "stat open again");
+  CHECK (after.calls == before.calls + 2, "two more calls");
+  CHECK (after.errors == before.errors + 1, "one more error");
+  CHECK (timed (&after) == timed (&before) + 2, "two more timed returns");
+
+  seek (fd, 10);
+  CHECK (tell (fd) == 10, "tell returns position");
+  CHECK (syscall_stat (-1, &after) == -1, "bad number rejected");
+  close (fd);
+}
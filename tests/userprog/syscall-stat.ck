@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-stat) begin
+(syscall-stat) stat open
+(syscall-stat) open "sample.txt"
+(syscall-stat) open "no-such-file"
+(syscall-stat) stat open again
+(syscall-stat) two more calls
+(syscall-stat) one more error
+(syscall-stat) two more timed returns
+(syscall-stat) tell returns position
+(syscall-stat) bad number rejected
+(syscall-stat) end
+syscall-stat: exit(0)
+EOF
+pass;
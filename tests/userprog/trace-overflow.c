@@ -0,0 +1,38 @@
+/* Logs more calls than the kernel trace buffer holds before
+   reading, then checks that trace_read() returns the newest
+   records in order instead of nothing. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include <syscall-trace.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* 커널 trace 버퍼 크기 (userprog/trace.c 의 TRACE_ENTRIES) */
+#define TRACE_ENTRIES 256
+#define CALL_CNT 300
+
+static struct trace_rec recs[CALL_CNT];
+
+void
+test_main (void) 
+{
+  int i, n;
+
+  trace_ctl (0, true);
+  for (i = 0; i < CALL_CNT; i++)
+    open ("no-such-file");
+  trace_ctl (0, false);
+
+  CHECK ((n = trace_read (recs, CALL_CNT)) == TRACE_ENTRIES,
+         "read a full buffer after overflow");
+  for (i = 0; i < n; i++)
+    {
+      if (recs[i].nr != SYS_OPEN || (int) recs[i].ret != -1)
+        fail ("record %d is syscall %u", i, recs[i].nr);
+      if (i > 0 && recs[i].seq != recs[i - 1].seq + 1)
+        fail ("record %d is not consecutive", i);
+    }
+  msg ("kept the newest %d open calls in order", TRACE_ENTRIES);
+  CHECK (trace_read (recs, CALL_CNT) == 0, "nothing left to read");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(trace-overflow) begin
+(trace-overflow) read a full buffer after overflow
+(trace-overflow) kept the newest 256 open calls in order
+(trace-overflow) nothing left to read
+(trace-overflow) end
+trace-overflow: exit(0)
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Turns on syscall tracing for this process, makes two calls,
+   turns it off again and checks the records read back with
+   trace_read(). */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include <syscall-trace.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct trace_rec recs[8];
+
+void
+test_main (void) 
+{
+  int on, bad_open, created, off, n;
+
+  /* 사이에 msg() 를 부르면 write 도 기록되므로 결과만 모아 둔다. */
+  on = trace_ctl (0, true);
+  bad_open = open ("no-such-file");
+  created = create ("test.txt", 7);
+  off = trace_ctl (0, false);
+
+  CHECK (on == 0 && off == 0, "trace_ctl");
+  CHECK (bad_open == -1 && created, "traced calls");
+  CHECK ((n = trace_read (recs, 8)) == 3, "read 3 records");
+  CHECK (recs[0].nr == SYS_TRACE_CTL && (int) recs[0].ret == 0,
+         "trace_ctl recorded");
+  CHECK (recs[1].nr == SYS_OPEN && (int) recs[1].ret == -1,
+         "failed open recorded");
+  CHECK (recs[2].nr == SYS_CREATE && recs[2].ret == 1
+         && recs[2].args[1] == 7, "create recorded with its arguments");
+  CHECK (recs[0].tid == recs[2].tid
+         && recs[1].seq == recs[0].seq + 1 && recs[2].seq == recs[1].seq + 1,
+         "records are consecutive");
+  CHECK (trace_read (recs, 8) == 0, "nothing left to read");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(trace-self) begin
+(trace-self) trace_ctl
+(trace-self) traced calls
+(trace-self) read 3 records
+(trace-self) trace_ctl recorded
+(trace-self) failed open recorded
+(trace-self) create recorded with its arguments
+(trace-self) records are consecutive
+(trace-self) nothing left to read
+(trace-self) end
+trace-self: exit(0)
+EOF
+pass;
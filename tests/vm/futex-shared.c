@@ -0,0 +1,46 @@
+/* The parent and a forked child map the same file page at
+   different addresses and use a word in it as a futex. The
+   child sleeps on the word until the parent changes it and
+   wakes it, which only works if both see the same futex. */
+
+#include <futex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PARENT_MAP ((uint32_t *) 0x10000000)
+#define CHILD_MAP ((uint32_t *) 0x20000000)
+
+void
+test_main (void)
+{
+  volatile uint32_t *word = PARENT_MAP;
+  int handle;
+  pid_t pid;
+
+  CHECK (create ("futex.dat", 4096), "create \"futex.dat\"");
+  CHECK ((handle = open ("futex.dat")) > 1, "open \"futex.dat\"");
+  CHECK (mmap (PARENT_MAP, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"futex.dat\"");
+  *word = 0;
+
+  if ((pid = fork ("child")) == 0)
+    {
+      int fd = open ("futex.dat");
+
+      if (fd < 2 || mmap (CHILD_MAP, 4096, 1, fd, 0) == MAP_FAILED)
+        exit (1);
+      word = CHILD_MAP;
+      *word = 2;
+      while (*word == 2)
+        futex ((uint32_t *) word, FUTEX_WAIT, 2);
+      exit (*word == 1 ? 0 : 2);
+    }
+
+  /* 자식이 잠들러 갈 때까지 기다렸다가 값을 바꾸고 깨운다. */
+  while (*word != 2)
+    continue;
+  *word = 1;
+  futex ((uint32_t *) word, FUTEX_WAKE, 1);
+  CHECK (wait (pid) == 0, "child woke up");
+}
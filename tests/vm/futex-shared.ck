@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(futex-shared) begin
+(futex-shared) create "futex.dat"
+(futex-shared) open "futex.dat"
+(futex-shared) mmap "futex.dat"
+(futex-shared) child woke up
+(futex-shared) end
+EOF
+pass;
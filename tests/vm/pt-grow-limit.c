@@ -0,0 +1,49 @@
+/* Runs with -sl=64, so the stack may grow to 64 pages.  Grows the
+   stack close to that limit, then checks that a child reaching
+   past it is killed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LIMIT_PAGES 64
+#define PAGE 4096
+
+/* 스택에 PAGES 페이지짜리 배열을 잡고 페이지마다 써 본다. */
+#define TOUCH_STACK(PAGES)                                      \
+  do {                                                          \
+    volatile char buf[(PAGES) * PAGE];                          \
+    size_t i;                                                   \
+    for (i = 0; i < sizeof buf; i += PAGE)                      \
+      buf[i] = 1;                                               \
+  } while (0)
+
+static void NO_INLINE
+grow_within (void) 
+{
+  TOUCH_STACK (LIMIT_PAGES - 8);
+}
+
+static void NO_INLINE
+grow_past (void) 
+{
+  TOUCH_STACK (LIMIT_PAGES + 8);
+}
+
+void
+test_main (void) 
+{
+  pid_t child;
+
+  grow_within ();
+  msg ("grew stack to %d pages", LIMIT_PAGES - 8);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      grow_past ();
+      fail ("grew stack past the limit");
+    }
+  CHECK (child > 0, "fork");
+  CHECK (wait (child) == -1, "child past the limit exited with -1");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(pt-grow-limit) begin
+(pt-grow-limit) grew stack to 56 pages
+(pt-grow-limit) fork
+child: exit(-1)
+(pt-grow-limit) child past the limit exited with -1
+(pt-grow-limit) end
+pt-grow-limit: exit(0)
+EOF
+pass;
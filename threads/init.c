@@ -13,6 +13,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -21,6 +22,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -155,7 +157,19 @@ paging_init (uint64_t mem_end) {
 	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
 		uint64_t va = (uint64_t) ptov(pa);
 
-		perm = PTE_P | PTE_W;
+		/* 커널 코드와 겹치지 않는 2MB 구간은 PDE 하나로 매핑해서
+		 * TLB 엔트리와 페이지 테이블을 아낀다. 코드 영역은 읽기 전용으로
+		 * 두어야 해서 4KB 단위로 남긴다. */
+		if ((pa & HUGE_PGMASK) == 0 && pa + HUGE_PGSIZE <= mem_end
+				&& (va + HUGE_PGSIZE <= (uint64_t) &start
+					|| (uint64_t) &_end_kernel_text <= va)) {
+			if ((pte = pml4e_walk_huge (pml4, va, 1)) != NULL)
+				*pte = pa | PTE_P | PTE_W | PTE_PS | PTE_G;
+			pa += HUGE_PGSIZE - PGSIZE;
+			continue;
+		}
+
+		perm = PTE_P | PTE_W | PTE_G;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
@@ -165,6 +179,12 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+	pml4_tlb_init ();
+
+	/* 커널 모드에서도 읽기 전용 페이지에 쓰면 폴트가 나게 한다.
+	 * 그래야 copy_to_user 가 읽기 전용 유저 페이지(코드, 공유 zero
+	 * 프레임)를 덮어쓰지 않고 실패하거나 VM 이 처리할 수 있다. */
+	lcr0 (rcr0 () | CR0_WP);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +246,10 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-sl"))
+			stack_page_limit = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +352,9 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -sl=COUNT          Limit user stack to COUNT pages.\n"
 #endif
 			);
 	power_off ();
@@ -354,6 +381,7 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	malloc_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -361,5 +389,6 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	syscall_print_stats ();
 #endif
 }
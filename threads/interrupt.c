@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -460,6 +461,15 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* 유저 모드로 돌아가기 전에, 다른 스레드가 프로세스를 끝내는 중이면
+	 * 유저 코드만 도는 clone 도 여기서 끝난다. */
+	if (frame->cs == SEL_UCSEG && thread_current ()->proc->group_exiting) {
+		intr_enable ();
+		process_check_exit ();
+	}
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -1,11 +1,14 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -28,18 +31,46 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   다만 경계에서 arena 를 만들고 푸는 일이 반복되지 않도록 클래스마다
+   빈 arena 를 ARENA_KEEP 개까지는 풀지 않고 empty_arenas 에 남겨 둔다.
+   남겨 둔 arena 는 malloc_trim() 이 한꺼번에 돌려준다.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* 크기 클래스마다 CPU 별 캐시(빈 블록 포인터 배열)를 둔다. 보통의
+   malloc()/free() 는 인터럽트만 잠깐 끄고 여기서 꺼내고 넣으므로
+   d->lock 을 잡지 않는다. 캐시가 비거나 차면 CACHE_BATCH 개씩
+   descriptor 의 free_list 와 주고받는데, 이때만 락을 잡는다.
+   캐시에 있는 블록은 arena 의 free_cnt 에서 쓰이는 중으로 센다. */
+#define CACHE_SIZE 32
+#define CACHE_BATCH 16
+
+/* 클래스마다 풀지 않고 남겨 두는 빈 arena 수. */
+#define ARENA_KEEP 2
+
+struct block_cache {
+	size_t cnt;
+	struct block *blocks[CACHE_SIZE];
+};
+
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+	struct block_cache cache;   /* CPU 가 하나라 캐시도 하나 */
+	struct list empty_arenas;   /* 남겨 둔 빈 arena (첫 블록으로 잇는다) */
+	size_t empty_cnt;           /* empty_arenas 길이 */
+
+	/* 통계. allocs/frees 는 인터럽트를 끄고, arenas 는 락을 잡고 고친다. */
+	uint64_t allocs;            /* malloc() 횟수 */
+	uint64_t frees;             /* free() 횟수 */
+	size_t arenas;              /* 지금 가진 arena 수 */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -61,8 +92,16 @@ struct block {
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* 페이지 단위로 따로 받은 큰 블록 통계. */
+static uint64_t big_allocs, big_frees;
+static size_t big_pages;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *desc_refill (struct desc *);
+static void desc_flush (struct desc *, struct block *);
+static void desc_free_block (struct desc *, struct block *);
+static size_t desc_trim (struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -76,6 +115,11 @@ malloc_init (void) {
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+		d->cache.cnt = 0;
+		list_init (&d->empty_arenas);
+		d->empty_cnt = 0;
+		d->allocs = d->frees = 0;
+		d->arenas = 0;
 	}
 }
 
@@ -86,6 +130,7 @@ malloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	enum intr_level old_level;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -104,6 +149,11 @@ malloc (size_t size) {
 		if (a == NULL)
 			return NULL;
 
+		old_level = intr_disable ();
+		big_allocs++;
+		big_pages += page_cnt;
+		intr_set_level (old_level);
+
 		/* Initialize the arena to indicate a big block of PAGE_CNT
 		   pages, and return it. */
 		a->magic = ARENA_MAGIC;
@@ -112,34 +162,21 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+	/* 캐시에 있으면 락 없이 바로 준다. */
+	old_level = intr_disable ();
+	b = d->cache.cnt > 0 ? d->cache.blocks[--d->cache.cnt] : NULL;
+	if (b != NULL)
+		d->allocs++;
+	intr_set_level (old_level);
+	if (b != NULL)
+		return b;
+
+	b = desc_refill (d);
+	if (b != NULL) {
+		old_level = intr_disable ();
+		d->allocs++;
+		intr_set_level (old_level);
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
 	return b;
 }
 
@@ -166,6 +203,9 @@ calloc (size_t a, size_t b) {
 /* Returns the number of bytes allocated for BLOCK. */
 static size_t
 block_size (void *block) {
+	if (kmem_owns (block))
+		return kmem_obj_size (block);
+
 	struct block *b = block;
 	struct arena *a = block_to_arena (b);
 	struct desc *d = a->desc;
@@ -173,6 +213,40 @@ block_size (void *block) {
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* 옮기지 않고 BLOCK 을 NEW_SIZE 바이트로 바꿀 수 있으면 바꾸고 true.
+   지금 블록 안에 들어가면 그대로 쓰고, 큰 블록은 뒤쪽 페이지를
+   떼어 내거나 바로 뒤의 빈 페이지를 붙여서 줄이고 늘린다. */
+static bool
+realloc_in_place (void *block, size_t new_size) {
+	struct arena *a;
+	size_t page_cnt;
+
+	if (kmem_owns (block))
+		return new_size <= kmem_obj_size (block);
+
+	a = block_to_arena (block);
+	if (a->desc != NULL)
+		return new_size <= a->desc->block_size;
+
+	/* 큰 블록. a->free_cnt 가 페이지 수다. */
+	page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+	if (page_cnt < a->free_cnt) {
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	} else if (page_cnt > a->free_cnt) {
+		if (!palloc_extend_multiple (a, a->free_cnt, page_cnt - a->free_cnt))
+			return false;
+	} else
+		return true;
+
+	enum intr_level old_level = intr_disable ();
+	big_pages += page_cnt;
+	big_pages -= a->free_cnt;
+	intr_set_level (old_level);
+	a->free_cnt = page_cnt;
+	return true;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -184,6 +258,8 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
+	} else if (old_block != NULL && realloc_in_place (old_block, new_size)) {
+		return old_block;
 	} else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
@@ -200,6 +276,11 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
+	/* kmem_cache_alloc() 으로 받은 객체는 그 캐시로 돌려준다. */
+	if (p != NULL && kmem_owns (p)) {
+		kmem_free (p);
+		return;
+	}
 	if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
@@ -213,32 +294,208 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* 캐시에 자리가 있으면 락 없이 넣는다. */
+			enum intr_level old_level = intr_disable ();
+			d->frees++;
+			if (d->cache.cnt < CACHE_SIZE) {
+				d->cache.blocks[d->cache.cnt++] = b;
+				intr_set_level (old_level);
+				return;
 			}
+			intr_set_level (old_level);
 
-			lock_release (&d->lock);
+			desc_flush (d, b);
 		} else {
 			/* It's a big block.  Free its pages. */
+			enum intr_level old_level = intr_disable ();
+			big_frees++;
+			big_pages -= a->free_cnt;
+			intr_set_level (old_level);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
 
+/* D 의 free_list 에서 블록 하나를 꺼내 돌려주고, CACHE_BATCH 개까지
+   더 꺼내 캐시를 채운다. free_list 가 비었으면 새 arena 를 만든다.
+   메모리가 없으면 NULL. */
+static struct block *
+desc_refill (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+	size_t i;
+
+	lock_acquire (&d->lock);
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		if (!list_empty (&d->empty_arenas)) {
+			/* 남겨 둔 빈 arena 부터 다시 쓴다. */
+			b = list_entry (list_pop_front (&d->empty_arenas), struct block,
+					free_elem);
+			a = block_to_arena (b);
+			d->empty_cnt--;
+		} else {
+			/* Allocate a page. */
+			a = palloc_get_page (0);
+			if (a == NULL) {
+				lock_release (&d->lock);
+				return NULL;
+			}
+			a->magic = ARENA_MAGIC;
+			a->desc = d;
+			a->free_cnt = d->blocks_per_arena;
+			d->arenas++;
+		}
+
+		/* Initialize arena and add its blocks to the free list. */
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+	}
+
+	/* Get a block from free list and return it. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	block_to_arena (b)->free_cnt--;
+
+	/* 나머지는 캐시로. 그사이 free() 가 캐시를 채웠으면 거기서 멈춘다. */
+	for (i = 1; i < CACHE_BATCH && !list_empty (&d->free_list); i++) {
+		enum intr_level old_level = intr_disable ();
+		struct block *c;
+
+		if (d->cache.cnt >= CACHE_SIZE) {
+			intr_set_level (old_level);
+			break;
+		}
+		c = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+		block_to_arena (c)->free_cnt--;
+		d->cache.blocks[d->cache.cnt++] = c;
+		intr_set_level (old_level);
+	}
+	lock_release (&d->lock);
+	return b;
+}
+
+/* 캐시가 찼을 때 B 와 함께 캐시의 오래된 블록 CACHE_BATCH 개를
+   D 의 free_list 로 돌려준다. */
+static void
+desc_flush (struct desc *d, struct block *b) {
+	struct block *batch[CACHE_BATCH];
+	enum intr_level old_level;
+	size_t cnt, i;
+
+	old_level = intr_disable ();
+	cnt = d->cache.cnt < CACHE_BATCH ? d->cache.cnt : CACHE_BATCH;
+	memcpy (batch, d->cache.blocks, cnt * sizeof *batch);
+	memmove (d->cache.blocks, d->cache.blocks + cnt,
+			(d->cache.cnt - cnt) * sizeof *d->cache.blocks);
+	d->cache.cnt -= cnt;
+	intr_set_level (old_level);
+
+	lock_acquire (&d->lock);
+	desc_free_block (d, b);
+	for (i = 0; i < cnt; i++)
+		desc_free_block (d, batch[i]);
+	lock_release (&d->lock);
+}
+
+/* B 를 D 의 free_list 에 넣는다. d->lock 을 잡고 불러야 한다. */
+static void
+desc_free_block (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+
+		/* ARENA_KEEP 개까지는 풀지 않고 남겨 둔다. */
+		if (d->empty_cnt < ARENA_KEEP) {
+			list_push_front (&d->empty_arenas, &arena_to_block (a, 0)->free_elem);
+			d->empty_cnt++;
+		} else {
+			d->arenas--;
+			palloc_free_page (a);
+		}
+	}
+}
+
+/* D 의 캐시를 비우고 남겨 둔 빈 arena 를 모두 돌려준다.
+   d->lock 을 잡고 불러야 한다. 돌려준 페이지 수를 반환한다. */
+static size_t
+desc_trim (struct desc *d) {
+	struct block *batch[CACHE_SIZE];
+	enum intr_level old_level;
+	size_t cnt, i, freed = 0;
+
+	old_level = intr_disable ();
+	cnt = d->cache.cnt;
+	memcpy (batch, d->cache.blocks, cnt * sizeof *batch);
+	d->cache.cnt = 0;
+	intr_set_level (old_level);
+	for (i = 0; i < cnt; i++)
+		desc_free_block (d, batch[i]);
+
+	while (!list_empty (&d->empty_arenas)) {
+		struct block *b = list_entry (list_pop_front (&d->empty_arenas),
+				struct block, free_elem);
+		d->empty_cnt--;
+		d->arenas--;
+		palloc_free_page (block_to_arena (b));
+		freed++;
+	}
+	return freed;
+}
+
+/* 모든 크기 클래스의 캐시와 남겨 둔 빈 arena 를 페이지 할당자에
+   돌려준다. 메모리가 모자랄 때 부른다. 이미 락이 잡혀 있는 클래스는
+   (malloc() 도중 palloc 이 실패해서 들어온 경우 등) 건너뛴다.
+   돌려준 페이지 수를 반환한다. */
+size_t
+malloc_trim (void) {
+	size_t freed = 0;
+
+	for (struct desc *d = descs; d < descs + desc_cnt; d++)
+		if (!lock_held_by_current_thread (&d->lock)
+				&& lock_try_acquire (&d->lock)) {
+			freed += desc_trim (d);
+			lock_release (&d->lock);
+		}
+	return freed;
+}
+
+/* Prints malloc statistics. */
+void
+malloc_print_stats (void) {
+	for (struct desc *d = descs; d < descs + desc_cnt; d++) {
+		size_t live = d->allocs - d->frees;
+
+		if (d->allocs == 0)
+			continue;
+		/* wasted: arena 페이지 중 살아 있는 블록이 차지하지 않은 바이트
+		   (빈 블록, 캐시, arena 헤더, 페이지 끝 자투리). */
+		printf ("Malloc: %4zu-byte class: %"PRIu64" allocs, %"PRIu64" frees, "
+				"%zu arenas, %zu bytes wasted\n",
+				d->block_size, d->allocs, d->frees, d->arenas,
+				d->arenas * PGSIZE - live * d->block_size);
+	}
+	if (big_allocs > 0)
+		printf ("Malloc: big blocks: %"PRIu64" allocs, %"PRIu64" frees, "
+				"%zu pages\n", big_allocs, big_frees, big_pages);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -2,20 +2,101 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+#define CPUID_PCID (1 << 17)            /* CPUID.1:ECX */
+#define CPUID_PGE (1 << 13)             /* CPUID.1:EDX */
+#define CR4_PGE (1 << 7)
+#define CR4_PCIDE (1 << 17)
+#define CR3_NOFLUSH (1UL << 63)
+
+/* PCID 를 쓰면 CR3 를 바꿔도 TLB 를 비우지 않는다. pml4 마다 PCID 를
+ * 하나씩 주고, 슬롯이 모자라면 돌아가며 다시 쓴다. 0 은 base_pml4 용.
+ * 올라가 있지 않은 pml4 의 엔트리를 바꾸면 그 PCID 를 stale 로 표시해서
+ * 다음에 올릴 때만 비운다. 인터럽트를 끈 채로 다룬다. */
+#define PCID_CNT 64
+static bool pcid_enabled;
+static uint64_t *pcid_owner[PCID_CNT];
+static bool pcid_stale[PCID_CNT];
+static unsigned pcid_next = 1;
+
+/* PML4 가 가진 PCID. 없으면 -1. */
+static int
+pcid_find (uint64_t *pml4) {
+	for (int i = 0; i < PCID_CNT; i++)
+		if (pcid_owner[i] == pml4)
+			return i;
+	return -1;
+}
+
+/* PML4 의 VA 에 대한 TLB 엔트리를 무효화한다. 지금 올라가 있는 pml4 면
+ * invlpg 한 번으로 충분하고, 아니면 그 PCID 를 다음에 올릴 때 비운다.
+ * PCID 가 없으면 CR3 를 바꿀 때 어차피 비워진다. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4)) {
+		invlpg ((uint64_t) va);
+		return;
+	}
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		int pcid = pcid_find (pml4);
+		if (pcid > 0)
+			pcid_stale[pcid] = true;
+		intr_set_level (old_level);
+	}
+}
+
+/* 2MB 페이지로 매핑된 PDE 는 그 자체가 마지막 엔트리라 그대로 돌려준다.
+ * 4KB 엔트리를 새로 만들려는(CREATE) 경우에는 쪼갤 수 없으니 NULL. */
+/* 0 으로 채워 둔 페이지 테이블 페이지 캐시. 프로세스가 끝날 때 나온
+ * 테이블 페이지를 비워서 모아 두고, 새 테이블이 필요하면 여기서 먼저
+ * 꺼낸다. CPU 가 하나라 인터럽트만 끄면 CPU 별 캐시와 같다. */
+#define PT_CACHE_MAX 32
+static void *pt_cache[PT_CACHE_MAX];
+static size_t pt_cache_cnt;
+
+/* 0 으로 채워진 페이지 테이블 페이지 하나. */
+static void *
+pt_alloc (void) {
+	void *page = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (pt_cache_cnt > 0)
+		page = pt_cache[--pt_cache_cnt];
+	intr_set_level (old_level);
+	return page != NULL ? page : palloc_get_page (PAL_ZERO);
+}
+
+/* 0 으로 비워진 페이지 테이블 페이지 PAGE 를 돌려준다. */
+static void
+pt_free (void *page) {
+	enum intr_level old_level = intr_disable ();
+
+	if (pt_cache_cnt < PT_CACHE_MAX) {
+		pt_cache[pt_cache_cnt++] = page;
+		page = NULL;
+	}
+	intr_set_level (old_level);
+	if (page != NULL)
+		palloc_free_page (page);
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if (((uint64_t) pte & PTE_P) && ((uint64_t) pte & PTE_PS))
+			return create ? NULL : &pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page)
 					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 				else
@@ -37,7 +118,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -49,7 +130,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pdpe[idx])));
 		pdpe[idx] = 0;
 	}
 	return pte;
@@ -70,7 +151,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		uint64_t *pdpe = (uint64_t *) pml4e[idx];
 		if (!((uint64_t) pdpe & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -82,21 +163,42 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pml4e[idx])));
 		pml4e[idx] = 0;
 	}
 	return pte;
 }
 
+/* VA 를 덮는 page directory 엔트리(PDE)의 주소를 돌려준다.
+ * 2MB 페이지를 매핑할 때 쓰며, CREATE 면 중간 테이블을 새로 만든다. */
+uint64_t *
+pml4e_walk_huge (uint64_t *pml4e, const uint64_t va, int create) {
+	uint64_t *tables = pml4e;
+	int idx[2] = { PML4 (va), PDPE (va) };
+
+	for (int i = 0; i < 2; i++) {
+		if (!(tables[idx[i]] & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = pt_alloc ()) == NULL)
+				return NULL;
+			tables[idx[i]] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		tables = ptov (PTE_ADDR (tables[idx[i]]));
+	}
+	return &tables[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
  * allocation fails. */
+/* 유저 영역 엔트리는 0 인 페이지에서 시작하므로 커널 쪽만 복사한다. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = pt_alloc ();
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		memcpy (&pml4[PML4 (KERN_BASE)], &base_pml4[PML4 (KERN_BASE)],
+				PGSIZE - PML4 (KERN_BASE) * sizeof *pml4);
 	return pml4;
 }
 
@@ -122,10 +224,18 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
-					pml4_index, pdp_index, i))
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		/* 2MB 페이지는 PDE 를 그대로 넘긴다. */
+		if (((uint64_t) pte) & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+					pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -155,24 +265,34 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	return true;
 }
 
+/* VM 에서는 유저 프레임을 프레임 테이블이 갖고 있고 pml4_destroy 전에
+ * supplemental_page_table_kill 에서 모두 풀리므로, 엔트리를 하나씩 볼
+ * 필요 없이 테이블 페이지만 통째로 비워서 돌려준다. */
 static void
 pt_destroy (uint64_t *pt) {
+#ifndef VM
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pt);
+#endif
+	memset (pt, 0, PGSIZE);
+	pt_free (pt);
 }
 
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			pt_destroy (PTE_ADDR (pte));
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		/* 2MB 매핑은 커널 direct map 에만 쓰고 유저 쪽에는 만들지 않는다. */
+		ASSERT (!(((uint64_t) pte) & PTE_PS));
+		pt_destroy (PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pdp);
+	memset (pdp, 0, PGSIZE);
+	pt_free (pdp);
 }
 
 static void
@@ -182,7 +302,8 @@ pdpe_destroy (uint64_t *pdpe) {
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
-	palloc_free_page ((void *) pdpe);
+	memset (pdpe, 0, PGSIZE);
+	pt_free (pdpe);
 }
 
 /* Destroys pml4e, freeing all the pages it references. */
@@ -196,14 +317,72 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+
+	/* 같은 주소로 새 pml4 가 생겨도 예전 TLB 엔트리를 물려받지 않게 */
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		int pcid = pcid_find (pml4);
+		if (pcid > 0)
+			pcid_owner[pcid] = NULL;
+		intr_set_level (old_level);
+	}
+	memset (pml4, 0, PGSIZE);
+	pt_free (pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
  * register. */
+/* 이미 올라가 있으면 CR3 를 다시 쓰지 않는다. PCID 를 쓰면 바꿀 때도
+ * stale 표시가 없는 한 TLB 를 비우지 않는다. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t *target = pml4 ? pml4 : base_pml4;
+	uint64_t cr3 = vtop (target);
+	enum intr_level old_level;
+	int pcid;
+
+	if (!pcid_enabled) {
+		if (PTE_ADDR (rcr3 ()) != cr3)
+			lcr3 (cr3);
+		return;
+	}
+
+	old_level = intr_disable ();
+	pcid = target == base_pml4 ? 0 : pcid_find (target);
+	if (pcid < 0) {
+		/* 슬롯을 새로 받으면 이전 주인의 엔트리가 남아 있으니 비운다. */
+		pcid = pcid_next;
+		pcid_next = pcid_next + 1 < PCID_CNT ? pcid_next + 1 : 1;
+		pcid_owner[pcid] = target;
+		pcid_stale[pcid] = true;
+	}
+	cr3 |= pcid;
+	if (pcid_stale[pcid]) {
+		pcid_stale[pcid] = false;
+		lcr3 (cr3);
+	} else if (rcr3 () != cr3)
+		lcr3 (cr3 | CR3_NOFLUSH);
+	intr_set_level (old_level);
+}
+
+/* 커널 매핑을 global 로 두고, CPU 가 지원하면 PCID 를 켠다.
+ * paging_init 에서 base_pml4 를 올린 직후 한 번 부른다. */
+void
+pml4_tlb_init (void) {
+	uint32_t a, b, c, d;
+	uint64_t cr4 = rcr4 ();
+
+	cpuid (1, &a, &b, &c, &d);
+	if (d & CPUID_PGE)
+		cr4 |= CR4_PGE;
+	if (c & CPUID_PCID) {
+		/* PCIDE 는 CR3 의 PCID 가 0 일 때만 켤 수 있다. */
+		ASSERT ((rcr3 () & PTE_FLAGS) == 0);
+		cr4 |= CR4_PCIDE;
+		pcid_owner[0] = base_pml4;
+		pcid_enabled = true;
+	}
+	lcr4 (cr4);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -219,6 +398,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
+	if (pte && (*pte & PTE_P) && (*pte & PTE_PS))
+		return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & HUGE_PGMASK);
 	if (pte && (*pte & PTE_P))
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
 	return NULL;
@@ -248,8 +429,13 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		uint64_t old = *pte;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		/* 있던 매핑을 덮어쓰면 예전 엔트리가 TLB 에 남지 않게 */
+		if (old & PTE_P)
+			tlb_invalidate (pml4, upage);
+	}
 	return pte != NULL;
 }
 
@@ -276,8 +462,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -307,8 +492,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -338,7 +522,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
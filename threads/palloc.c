@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -26,11 +28,34 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
+/* 각 풀은 buddy allocator 로 관리한다. order k 블록은 2^k 페이지이고
+   풀 안에서 2^k 로 정렬되어 있다. order 별 빈 블록 리스트에서 꺼내고
+   나누거나, 돌려받을 때 짝(buddy)과 합치는 것 모두 O(log n) 이다.
+   빈 블록의 list_elem 은 그 블록의 첫 페이지 안에 둔다.
+   페이지는 스케줄러 안(인터럽트가 꺼진 상태)에서도 해제되므로 락 대신
+   인터럽트를 꺼서 풀을 보호한다. */
+#define MAX_ORDER 10                    /* 최대 블록 2^10 페이지 = 4MB */
+
+/* 한 페이지짜리 할당/해제는 CPU 별 매거진(빈 페이지 몇 개를 담아 둔
+   배열)에서 먼저 처리하고, 비거나 차면 MAG_BATCH 개씩 buddy 와
+   주고받는다. 매거진에 있는 페이지는 used_map 에서 빈 것으로 둔다. */
+#define MAG_SIZE 32
+#define MAG_BATCH 16
+
+struct page_mag {
+	size_t cnt;
+	size_t pages[MAG_SIZE];         /* 풀 안의 페이지 번호 */
+};
+
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
+	int8_t *order_map;              /* 빈 블록의 첫 페이지면 order, 아니면 -1 */
+	struct list free_list[MAX_ORDER + 1];   /* order 별 빈 블록 */
+	struct page_mag mag;            /* CPU 가 하나라 매거진도 하나 */
+	struct page_mag zeroed;         /* idle 때 0 으로 채워 둔 빈 페이지 */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +67,13 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static size_t pool_alloc_run (struct pool *, size_t page_cnt);
+static void pool_free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static bool pool_claim (struct pool *, size_t page_idx);
+static size_t mag_get (struct pool *);
+static void mag_put (struct pool *, size_t page_idx);
+static void mag_drain (struct pool *, size_t cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -223,12 +255,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free_range (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free_range (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,10 +294,34 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	struct page_mag *zeroed = &pool->zeroed;
+	size_t page_idx;
+	bool is_zero = false;
+
+	enum intr_level old_level = intr_disable ();
+	if (page_cnt == 1) {
+		if ((flags & PAL_ZERO) && zeroed->cnt > 0) {
+			page_idx = zeroed->pages[--zeroed->cnt];
+			is_zero = true;
+		} else
+			page_idx = mag_get (pool);
+		/* 남은 게 미리 채워 둔 페이지뿐이면 그거라도 쓴다. */
+		if (page_idx == BITMAP_ERROR && zeroed->cnt > 0)
+			page_idx = zeroed->pages[--zeroed->cnt];
+	} else {
+		page_idx = pool_alloc (pool, page_cnt);
+		/* 매거진에 붙잡혀 있는 페이지 때문에 실패했을 수도 있다. */
+		if (page_idx == BITMAP_ERROR
+				&& (pool->mag.cnt > 0 || zeroed->cnt > 0)) {
+			mag_drain (pool, pool->mag.cnt);
+			for (; zeroed->cnt > 0; zeroed->cnt--)
+				pool_free_range (pool, zeroed->pages[zeroed->cnt - 1], 1);
+			page_idx = pool_alloc (pool, page_cnt);
+		}
+	}
+	if (page_idx != BITMAP_ERROR)
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	intr_set_level (old_level);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -274,9 +330,14 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 		pages = NULL;
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !is_zero)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
+		/* 커널 풀이 바닥나면 malloc 이 들고 있는 빈 arena 를 돌려받고
+		   다시 해 본다. malloc_trim() 은 락을 잡으므로 잘 수 있을 때만. */
+		if (!(flags & PAL_USER) && !intr_context ()
+				&& intr_get_level () == INTR_ON && malloc_trim () > 0)
+			return palloc_get_multiple (flags, page_cnt);
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
 	}
@@ -318,8 +379,54 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	enum intr_level old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1)
+		mag_put (pool, page_idx);
+	else
+		pool_free_range (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
+}
+
+/* PAGES 에서 시작하는 PAGE_CNT 페이지 바로 뒤의 EXTRA 페이지가 모두
+   비어 있으면 그 자리에서 떼어 붙인다. 성공하면 true 이고 PAGES 는
+   PAGE_CNT + EXTRA 페이지가 된다. 매거진에 들어 있는 페이지는
+   쓰지 않는다. */
+bool
+palloc_extend_multiple (void *pages, size_t page_cnt, size_t extra) {
+	struct pool *pool;
+	size_t page_idx, i;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	if (extra == 0)
+		return true;
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	if (page_idx + extra > bitmap_size (pool->used_map))
+		return false;
+
+	enum intr_level old_level = intr_disable ();
+	if (bitmap_none (pool->used_map, page_idx, extra)) {
+		/* 모두 buddy 에 있어야 한다. 하나라도 아니면 건드리기 전에 그만둔다. */
+		for (i = 0; i < extra; i++)
+			if (!pool_claim (pool, page_idx + i))
+				break;
+		if (i == extra) {
+			bitmap_set_multiple (pool->used_map, page_idx, extra, true);
+			success = true;
+		} else if (i > 0)
+			pool_free_range (pool, page_idx, i);
+	}
+	intr_set_level (old_level);
+	return success;
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +435,53 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return pool->free_cnt + pool->mag.cnt + pool->zeroed.cnt;
+}
+
+/* POOL 의 zeroed 가 덜 찼으면 빈 페이지 하나를 0 으로 채워 넣는다.
+   채웠으면 true. memset 은 인터럽트를 켠 채로 한다. */
+static bool
+zero_one (struct pool *pool) {
+	size_t page_idx = BITMAP_ERROR;
+	enum intr_level old_level = intr_disable ();
+
+	if (pool->zeroed.cnt < MAG_SIZE)
+		page_idx = pool_alloc (pool, 1);
+	intr_set_level (old_level);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+
+	old_level = intr_disable ();
+	pool->zeroed.pages[pool->zeroed.cnt++] = page_idx;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* idle 스레드가 할 일이 없을 때 불러서 두 풀의 zeroed 를 한 페이지씩
+   채운다. PAL_ZERO 한 페이지 요청은 여기서 꺼내면 memset 을 하지 않아도
+   된다. 더 채울 게 없으면 false. 인터럽트를 켠 채로 불러야 한다. */
+bool
+palloc_zero_idle (void) {
+	bool filled = zero_one (&kernel_pool);
+	filled |= zero_one (&user_pool);
+	return filled;
+}
+
+/* Returns the total number of pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_pool_size (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return bitmap_size (pool->used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -336,15 +490,193 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t om_pages = DIV_ROUND_UP (pgcnt, PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->free_cnt = 0;
+	p->order_map = *bm_base + bm_pages;
+	p->mag.cnt = 0;
+	p->zeroed.cnt = 0;
+	for (int i = 0; i <= MAX_ORDER; i++)
+		list_init (&p->free_list[i]);
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->order_map, -1, pgcnt);
+
+	*bm_base += bm_pages + om_pages;
+}
 
-	*bm_base += bm_pages;
+/* POOL 에서 PAGE_CNT 페이지를 buddy 로 떼어 내고 첫 페이지 번호를
+   돌려준다. 모자라면 BITMAP_ERROR. used_map 은 부른 쪽에서 채운다. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+	unsigned order = 0, o;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (page_cnt > (size_t) 1 << MAX_ORDER)
+		return pool_alloc_run (pool, page_cnt);
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+	for (o = order; o <= MAX_ORDER; o++)
+		if (!list_empty (&pool->free_list[o]))
+			break;
+	if (page_cnt == 0 || o > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = pg_no (list_pop_front (&pool->free_list[o])) - pg_no (pool->base);
+	pool->order_map[page_idx] = -1;
+	pool->free_cnt -= (size_t) 1 << o;
+
+	/* 큰 블록을 반씩 나눠 뒤쪽 반을 한 단계 아래 리스트에 넣는다. */
+	while (o > order) {
+		o--;
+		size_t buddy = page_idx + ((size_t) 1 << o);
+		pool->order_map[buddy] = o;
+		list_push_front (&pool->free_list[o],
+				(struct list_elem *) (pool->base + PGSIZE * buddy));
+		pool->free_cnt += (size_t) 1 << o;
+	}
+	/* 2^order 보다 적게 요청했으면 남는 뒤쪽 페이지는 돌려준다. */
+	pool_free_range (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* 2^MAX_ORDER 페이지보다 큰 요청은 buddy 블록 하나로 안 되므로
+   used_map 에서 비어 있는 연속 구간을 찾아 한 페이지씩 떼어 낸다.
+   드물고 느린 길이다. 모자라면 BITMAP_ERROR. */
+static size_t
+pool_alloc_run (struct pool *pool, size_t page_cnt) {
+	size_t start = 0, i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while ((start = bitmap_scan (pool->used_map, start, page_cnt, false))
+			!= BITMAP_ERROR) {
+		for (i = 0; i < page_cnt; i++)
+			if (!pool_claim (pool, start + i))
+				break;
+		if (i == page_cnt)
+			return start;
+		/* 매거진에 든 페이지를 만났다. 떼어 낸 앞쪽은 돌려주고 그 뒤부터 찾는다. */
+		pool_free_range (pool, start, i);
+		start += i + 1;
+	}
+	return BITMAP_ERROR;
+}
+
+/* 매거진에서 한 페이지를 꺼낸다. 비어 있으면 buddy 에서 한 묶음 채운다. */
+static size_t
+mag_get (struct pool *pool) {
+	struct page_mag *mag = &pool->mag;
+
+	while (mag->cnt < MAG_BATCH) {
+		size_t page_idx = pool_alloc (pool, 1);
+		if (page_idx == BITMAP_ERROR)
+			break;
+		mag->pages[mag->cnt++] = page_idx;
+	}
+	if (mag->cnt == 0)
+		return BITMAP_ERROR;
+	return mag->pages[--mag->cnt];
+}
+
+/* 한 페이지를 매거진에 넣는다. 가득 차 있으면 절반을 buddy 로 돌려준다. */
+static void
+mag_put (struct pool *pool, size_t page_idx) {
+	struct page_mag *mag = &pool->mag;
+
+	bitmap_reset (pool->used_map, page_idx);
+	if (mag->cnt == MAG_SIZE)
+		mag_drain (pool, MAG_BATCH);
+	mag->pages[mag->cnt++] = page_idx;
+}
+
+/* 매거진 바닥의 CNT 페이지를 buddy 로 돌려준다. */
+static void
+mag_drain (struct pool *pool, size_t cnt) {
+	struct page_mag *mag = &pool->mag;
+
+	ASSERT (cnt <= mag->cnt);
+	for (size_t i = 0; i < cnt; i++)
+		pool_free_range (pool, mag->pages[i], 1);
+	memmove (mag->pages, mag->pages + cnt, (mag->cnt - cnt) * sizeof *mag->pages);
+	mag->cnt -= cnt;
+}
+
+/* POOL 의 PAGE_IDX 부터 2^ORDER 페이지 블록을 빈 블록으로 돌려준다.
+   짝 블록도 비어 있으면 합쳐서 한 단계 위로 올라간다. */
+static void
+pool_free_block (struct pool *pool, size_t page_idx, unsigned order) {
+	size_t pgcnt = bitmap_size (pool->used_map);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	pool->free_cnt += (size_t) 1 << order;
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+		if (buddy + ((size_t) 1 << order) > pgcnt
+				|| pool->order_map[buddy] != (int8_t) order)
+			break;
+		list_remove ((struct list_elem *) (pool->base + PGSIZE * buddy));
+		pool->order_map[buddy] = -1;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	pool->order_map[page_idx] = order;
+	list_push_front (&pool->free_list[order],
+			(struct list_elem *) (pool->base + PGSIZE * page_idx));
+}
+
+/* PAGE_IDX 부터 PAGE_CNT 페이지를 정렬된 가장 큰 블록들로 나눠서
+   돌려준다. */
+static void
+pool_free_range (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	if (page_cnt > 0)
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	while (page_cnt > 0) {
+		unsigned order = 0;
+		while (order < MAX_ORDER
+				&& (page_idx & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		pool_free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* 빈 buddy 블록 안에 있는 PAGE_IDX 한 페이지만 떼어 낸다. 블록의
+   나머지는 다시 빈 블록으로 돌려준다. PAGE_IDX 가 빈 블록 안에 없으면
+   (매거진에 있거나 쓰이는 중) false. used_map 은 건드리지 않는다. */
+static bool
+pool_claim (struct pool *pool, size_t page_idx) {
+	size_t start = page_idx, end;
+	unsigned order;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (order = 0; order <= MAX_ORDER; order++) {
+		start = page_idx & ~(((size_t) 1 << order) - 1);
+		if (pool->order_map[start] == (int8_t) order)
+			break;
+	}
+	if (order > MAX_ORDER)
+		return false;
+
+	list_remove ((struct list_elem *) (pool->base + PGSIZE * start));
+	pool->order_map[start] = -1;
+	pool->free_cnt -= (size_t) 1 << order;
+	end = start + ((size_t) 1 << order);
+
+	/* pool_free_range 는 used_map 을 비우므로 원래 비어 있던 앞뒤만 돌려준다. */
+	pool_free_range (pool, start, page_idx - start);
+	pool_free_range (pool, page_idx + 1, end - page_idx - 1);
+	return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,254 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   kmem_cache 하나는 한 종류(같은 크기)의 객체만 다룬다. 페이지 하나가
+   slab 하나이고, 페이지 앞쪽에 slab 헤더와 빈 객체 번호를 잇는 bufctl
+   배열이 있고 그 뒤에 객체들이 빈틈없이 놓인다. 2의 거듭제곱으로
+   올려 잡는 malloc() 과 달리 객체 크기 그대로 나누므로 struct page 나
+   struct inode 처럼 애매한 크기에서 낭비가 적다.
+
+   남는 공간은 slab 마다 캐시 라인 단위로 객체 시작 위치를 밀어서
+   (coloring) 여러 slab 의 같은 번호 객체가 같은 캐시 세트에 몰리지
+   않게 한다.
+
+   생성자(ctor)는 slab 을 새로 만들 때 객체마다 한 번만 부른다.
+   빈 객체를 잇는 정보는 bufctl 에 따로 두므로 객체 내용은 해제해도
+   그대로 남고, 다음 할당 때 생성된 상태로 돌려줄 수 있다. 그래서
+   ctor 가 있는 캐시는 해제할 때 객체를 0xcc 로 덮지 않는다.
+
+   free() 는 페이지 앞의 magic 으로 slab 객체를 알아보고 여기로
+   넘기므로, kmem_cache_alloc() 으로 받은 객체를 free() 해도 된다. */
+
+#define SLAB_MAGIC 0x51ab51ab
+#define CACHE_LINE 64
+#define BUFCTL_END UINT16_MAX
+
+struct kmem_cache {
+	const char *name;
+	size_t size;                /* 정렬까지 맞춘 객체 크기 */
+	size_t objs_per_slab;       /* slab 하나의 객체 수 */
+	size_t obj_ofs;             /* 페이지 시작에서 첫 객체까지 (색 제외) */
+	size_t color_unit;          /* 색 하나의 간격 (캐시 라인) */
+	size_t color_cnt;           /* 쓸 수 있는 색 수 */
+	size_t color_next;          /* 다음 slab 에 줄 색 */
+	kmem_ctor_func *ctor;
+	struct list partial;        /* 빈 객체가 있는 slab */
+	struct list full;           /* 꽉 찬 slab */
+	struct slab *empty;         /* 다 빈 slab 하나는 남겨 둔다 */
+	struct lock lock;
+};
+
+/* 페이지 맨 앞. magic 은 malloc 의 arena 와 같은 자리에 있어야 한다. */
+struct slab {
+	unsigned magic;             /* SLAB_MAGIC */
+	struct kmem_cache *cache;
+	struct list_elem elem;      /* partial 또는 full */
+	size_t in_use;              /* 나가 있는 객체 수 */
+	size_t color;               /* 이 slab 의 객체 시작 오프셋 */
+	uint16_t free_head;         /* 첫 빈 객체 번호 */
+	uint16_t bufctl[];          /* 빈 객체 다음 번호 */
+};
+
+static struct slab *
+obj_to_slab (const void *obj) {
+	struct slab *s = pg_round_down (obj);
+	ASSERT (s->magic == SLAB_MAGIC);
+	return s;
+}
+
+static void *
+slab_obj (struct slab *s, size_t idx) {
+	return (uint8_t *) s + s->cache->obj_ofs + s->color + idx * s->cache->size;
+}
+
+/* SIZE 바이트, ALIGN 정렬 객체를 담는 캐시를 만든다. CTOR 는 없어도 된다. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n, leftover;
+
+	if (align < sizeof (void *))
+		align = sizeof (void *);
+	size = ROUND_UP (size, align);
+	/* 헤더를 뺀 페이지에 하나도 안 들어가는 크기는 아래에서 n 이 0 이 된다. */
+	ASSERT (size < PGSIZE);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+
+	/* 헤더 + bufctl 을 넣고도 들어가는 만큼 객체 수를 정한다. */
+	n = PGSIZE / size;
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align)
+			+ n * size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < BUFCTL_END);
+
+	c->name = name;
+	c->size = size;
+	c->objs_per_slab = n;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align);
+	leftover = PGSIZE - c->obj_ofs - n * size;
+	c->color_unit = ROUND_UP (CACHE_LINE, align);
+	c->color_cnt = leftover / c->color_unit + 1;
+	c->color_next = 0;
+	c->ctor = ctor;
+	list_init (&c->partial);
+	list_init (&c->full);
+	c->empty = NULL;
+	lock_init (&c->lock);
+	return c;
+}
+
+/* 새 slab 을 만들어 객체를 모두 빈 상태로 잇는다. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+
+	if (s == NULL)
+		return NULL;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->color = c->color_next * c->color_unit;
+	c->color_next = (c->color_next + 1) % c->color_cnt;
+	for (size_t i = 0; i < c->objs_per_slab; i++) {
+		s->bufctl[i] = i + 1 < c->objs_per_slab ? i + 1 : BUFCTL_END;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (s, i));
+	}
+	s->free_head = 0;
+	return s;
+}
+
+/* C 에서 객체 하나를 꺼낸다. 메모리가 없으면 NULL. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else {
+		if (c->empty != NULL) {
+			s = c->empty;
+			c->empty = NULL;
+		} else if ((s = slab_create (c)) == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = slab_obj (s, s->free_head);
+	s->free_head = s->bufctl[s->free_head];
+	if (++s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* OBJ 를 C 에 돌려준다. slab 이 다 비면 하나만 남기고 페이지를 푼다. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (obj);
+	ASSERT (s->cache == c);
+	idx = ((uint8_t *) obj - (uint8_t *) slab_obj (s, 0)) / c->size;
+	ASSERT (slab_obj (s, idx) == obj);
+
+#ifndef NDEBUG
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->size);
+#endif
+
+	lock_acquire (&c->lock);
+	if (s->in_use-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->bufctl[idx] = s->free_head;
+	s->free_head = idx;
+
+	if (s->in_use == 0) {
+		list_remove (&s->elem);
+		if (c->empty == NULL) {
+			c->empty = s;
+			s = NULL;
+		}
+	} else
+		s = NULL;
+	lock_release (&c->lock);
+
+	if (s != NULL)
+		palloc_free_page (s);
+}
+
+/* OBJ 가 slab 에서 나온 객체인지. */
+bool
+kmem_owns (const void *obj) {
+	const struct slab *s = pg_round_down (obj);
+	return s->magic == SLAB_MAGIC;
+}
+
+/* slab 객체 OBJ 의 크기. */
+size_t
+kmem_obj_size (const void *obj) {
+	return obj_to_slab (obj)->cache->size;
+}
+
+/* 어느 캐시 것인지 몰라도 slab 객체 OBJ 를 돌려준다. */
+void
+kmem_free (void *obj) {
+	kmem_cache_free (obj_to_slab (obj)->cache, obj);
+}
+
+/* C 가 제대로 나눠 주는지 확인한다. tests/threads/slab-basic 에서 부른다.
+   slab 두 개를 넘게 꺼내서 객체가 페이지 안에 있고 서로 겹치지 않는지
+   보고 모두 돌려준다. 생성자가 있는 캐시는 내용을 덮지 않고 위치만 본다. */
+void
+kmem_cache_self_test (struct kmem_cache *c) {
+	size_t cnt = c->objs_per_slab * 2 + 1;
+	uint8_t **objs = malloc (cnt * sizeof *objs);
+	size_t i, j;
+
+	ASSERT (objs != NULL);
+	for (i = 0; i < cnt; i++) {
+		uint8_t *obj = kmem_cache_alloc (c);
+
+		ASSERT (obj != NULL);
+		ASSERT ((uintptr_t) obj % sizeof (void *) == 0);
+		ASSERT (obj_to_slab (obj)->cache == c);
+		ASSERT (pg_round_down (obj) == pg_round_down (obj + c->size - 1));
+		ASSERT ((uint8_t *) obj_to_slab (obj) + c->obj_ofs <= obj);
+		if (c->ctor == NULL)
+			memset (obj, i & 0xff, c->size);
+		objs[i] = obj;
+	}
+	if (c->ctor == NULL) {
+		for (i = 0; i < cnt; i++)
+			for (j = 0; j < c->size; j++)
+				ASSERT (objs[i][j] == (i & 0xff));
+	}
+	for (i = 0; i < cnt; i++)
+		kmem_cache_free (c, objs[i]);
+	free (objs);
+}
@@ -254,9 +254,6 @@ thread_create (const char *name, int priority,
 	if(aux != NULL)
 	{
 		list_push_front(&thread_current()->child_list, &t->child_elem);
-		t->fd_table = palloc_get_multiple(PAL_ZERO, 2);
-		for(int i = 0; i < INT8_MAX; i++)
-			t->fd_table[i] = NULL;
 	}
 	/* Add to run queue. */
 	thread_unblock (t);
@@ -371,7 +368,9 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	list_insert_ordered(&ready_list, &curr->elem, priority_more, NULL);	
+	/* idle 은 ready 리스트에 넣지 않는다. 들어가면 ready 수에 잡혀 load_avg 가 는다. */
+	if (curr != idle_thread)
+		list_insert_ordered(&ready_list, &curr->elem, priority_more, NULL);	
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -531,6 +530,16 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* 돌릴 스레드가 없을 때만 빈 페이지를 미리 0 으로 채운다. idle 스레드가
+		   하므로 ready 수나 recent_cpu 에 잡히지 않고, 다른 스레드가 준비되면
+		   hlt 없이 바로 양보한다. */
+		intr_enable ();
+		while (list_empty (&ready_list) && palloc_zero_idle ())
+			continue;
+		intr_disable ();
+		if (!list_empty (&ready_list))
+			continue;
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -594,7 +603,17 @@ init_thread (struct thread *t, const char *name, int priority) {
 	list_init(&t->child_list);
 	t->wait_on_lock = NULL; // 초기화
 	t->exit_status = 1; // 종료 상태 0이면 잘 끝남 그 외에는 잘 안끝나서 추가 행동 필요
-	t->fd = 2; //0표준입력 1표준출력 2는 표준에러인데 pintos에는 없음
+	/* fd 테이블은 struct thread 안의 작은 배열로 시작한다.
+	 * 0 표준입력, 1 표준출력은 비트맵에서 쓰는 중으로 둔다. */
+	t->fd_table = t->fd_inline;
+	t->fd_cap = FD_INLINE;
+	t->fd_map = &t->fd_inline_map;
+	t->fd_inline_map = 0x3;
+	t->bounce = NULL;
+	lock_init(&t->fd_lock);
+	t->proc = t;
+	list_init(&t->clone_list);
+	t->group_exiting = false;
 	sema_init(&t->fork_sema, 0);
 	sema_init(&t->when_use_free_curr_sema, 0);
 	sema_init(&t->when_use_wait_other_sema, 0);
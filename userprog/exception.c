@@ -6,6 +6,7 @@
 #include "threads/thread.h"
 #include "intrinsic.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -87,7 +88,9 @@ kill (struct intr_frame *f) {
 			printf ("%s: dying due to interrupt %#04llx (%s).\n",
 					thread_name (), f->vec_no, intr_name (f->vec_no));
 			intr_dump_frame (f);
-			thread_exit ();
+			/* clone 한 스레드에서 나도 프로세스 전체를 끝낸다. */
+			sys_exit (-1);
+			NOT_REACHED ();
 
 		case SEL_KCSEG:
 			/* Kernel's code segment, which indicates a kernel bug.
@@ -149,6 +152,16 @@ page_fault (struct intr_frame *f) {
 
 	/* Count page faults. */
 	page_fault_cnt++;
+
+	/* uaccess-copy.S 에서 유저 메모리를 복사하다 난 폴트면 죽이지 않고
+	 * 복구 코드로 보내서 복사를 실패로 끝낸다. */
+	if (!user) {
+		uintptr_t fixup = search_exception_table (f->rip);
+		if (fixup != 0) {
+			f->rip = fixup;
+			return;
+		}
+	}
 	
 	if(user || not_present)
 		sys_exit(-1);
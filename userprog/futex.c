@@ -0,0 +1,160 @@
+#include "userprog/futex.h"
+#include <hash.h>
+#include <list.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Futex.
+
+   유저 락은 경쟁이 없으면 유저 공간의 원자적 연산만으로 잡고 풀고,
+   경쟁이 있을 때만 futex 로 커널에서 잔다. 기다리는 스레드는 futex
+   단어가 놓인 프레임의 커널 주소(곧 물리 주소)로 고른 버킷의 리스트에
+   들어간다. 그래서 같은 프레임을 매핑한 프로세스끼리는 가상 주소가
+   달라도 같은 futex 를 본다.
+
+   WAIT 는 버킷 락을 잡은 채 값을 확인하고 리스트에 들어가므로, 값을
+   바꾼 쪽이 WAKE 하면 깨움을 놓치지 않는다. 키를 구할 때 단어를 한
+   번 써서 공유 zero 프레임이 아닌 자기 프레임에 올리고, VM 에서는
+   기다리는 동안 프레임이 쫓겨나 키가 바뀌지 않도록 고정한다. */
+
+#define FUTEX_BUCKETS 64
+
+struct frame;
+
+struct futex_waiter {
+	void *key;                  /* futex 단어의 커널 주소 */
+	struct thread *thread;      /* 자는 스레드 */
+	struct semaphore sema;
+	struct list_elem elem;
+};
+
+struct futex_bucket {
+	struct lock lock;
+	struct list waiters;
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+static struct futex_bucket *
+futex_bucket (void *key) {
+	return &buckets[hash_bytes (&key, sizeof key) % FUTEX_BUCKETS];
+}
+
+/* UADDR 의 키를 구한다. 쓸 수 없는 주소면 NULL. VM 이면 프레임을
+ * 고정해서 *FRAMEP 로 주고, 부른 쪽이 futex_put() 으로 푼다. */
+static void *
+futex_get (uint32_t *uaddr, struct frame **framep) {
+#ifdef VM
+	return vm_pin_user (uaddr, framep);
+#else
+	*framep = NULL;
+	if (!touch_user_write (uaddr))
+		return NULL;
+	return pml4_get_page (thread_current ()->pml4, uaddr);
+#endif
+}
+
+static void
+futex_put (struct frame *frame) {
+#ifdef VM
+	vm_unpin_frame (frame);
+#else
+	(void) frame;
+#endif
+}
+
+/* *UADDR 이 아직 VAL 이면 futex_wake() 로 깨워질 때까지 잔다. 깨워지면
+ * 0, 값이 이미 바뀌었거나 주소가 잘못됐으면 -1. */
+int
+futex_wait (uint32_t *uaddr, uint32_t val) {
+	struct futex_waiter w;
+	struct futex_bucket *b;
+	struct frame *frame;
+
+	w.key = futex_get (uaddr, &frame);
+	if (w.key == NULL)
+		return -1;
+	b = futex_bucket (w.key);
+
+	lock_acquire (&b->lock);
+	if (*(volatile uint32_t *) w.key != val) {
+		lock_release (&b->lock);
+		futex_put (frame);
+		return -1;
+	}
+	sema_init (&w.sema, 0);
+	w.thread = thread_current ();
+	list_push_back (&b->waiters, &w.elem);
+	lock_release (&b->lock);
+
+	sema_down (&w.sema);
+	futex_put (frame);
+	return 0;
+}
+
+/* UADDR 에서 자는 스레드를 먼저 잠든 순서로 CNT 개까지 깨우고 깨운
+ * 수를 돌려준다. 주소가 잘못됐으면 -1. */
+int
+futex_wake (uint32_t *uaddr, uint32_t cnt) {
+	struct futex_bucket *b;
+	struct frame *frame;
+	struct list_elem *e;
+	void *key;
+	int woken = 0;
+
+	key = futex_get (uaddr, &frame);
+	if (key == NULL)
+		return -1;
+	b = futex_bucket (key);
+
+	lock_acquire (&b->lock);
+	for (e = list_begin (&b->waiters);
+			e != list_end (&b->waiters) && (uint32_t) woken < cnt; ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+		e = list_next (e);
+		if (w->key == key) {
+			list_remove (&w->elem);
+			sema_up (&w->sema);
+			woken++;
+		}
+	}
+	lock_release (&b->lock);
+	futex_put (frame);
+	return woken;
+}
+
+/* PROC 의 스레드 중 futex 에서 자는 것을 모두 깨운다. 프로세스가 끝날 때
+ * 기다리는 스레드들이 깨어나 끝날 수 있게 한다. */
+void
+futex_wake_group (struct thread *proc) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		struct futex_bucket *b = &buckets[i];
+		struct list_elem *e;
+
+		lock_acquire (&b->lock);
+		for (e = list_begin (&b->waiters); e != list_end (&b->waiters); ) {
+			struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+			e = list_next (e);
+			if (w->thread->proc == proc) {
+				list_remove (&w->elem);
+				sema_up (&w->sema);
+			}
+		}
+		lock_release (&b->lock);
+	}
+}
@@ -9,6 +9,7 @@
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
 #include "userprog/syscall.h"
+#include "userprog/futex.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -21,6 +22,7 @@
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #include "threads/synch.h"
+#include "threads/malloc.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -32,6 +34,8 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_clone (void *);
+static void reap_clones (struct thread *proc);
 
 
 /* General process initializer for initd and other process. */
@@ -200,14 +204,16 @@ __do_fork (void *aux) {
     process_activate(current);
 #ifdef VM
     supplemental_page_table_init(&current->spt);
-    if (!supplemental_page_table_copy(&current->spt, &parent->spt))
+	lock_acquire(&parent->spt.lock);
+	succ = supplemental_page_table_copy(&current->spt, &parent->spt);
+	lock_release(&parent->spt.lock);
+	if (!succ)
 		goto error;
+	current->stack_bottom = parent->stack_bottom;
 #else
     if (!pml4_for_each(parent->pml4, duplicate_pte, parent))
 		goto error;
 #endif
-	if(current->fd == INT8_MAX)
-		goto error;
 	/* TODO: Your code goes here.
 	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
 	 * TODO:       in include/filesys/file.h. Note that parent should not return
@@ -218,11 +224,11 @@ __do_fork (void *aux) {
 	 * TODO: 힌트) 파일 객체를 복제하려면 include/filesys/file.h에 있는
 	 * TODO: `file_duplicate`를 사용하세요. 이 함수가 부모의 자원을 성공적으로
 	 * TODO: 복제할 때까지 부모는 fork()에서 반환하면 안 됩니다.*/
-	for (int i = 2; i < INT8_MAX; i++) {
-		if (parent->fd_table[i] != NULL)
-			current->fd_table[i] = file_duplicate(parent->fd_table[i]);
-	}
-	current->fd = parent->fd;
+	if (!fd_table_copy(current, parent))
+		goto error;
+	/* 주소 공간을 그대로 복제했으니 링도 같은 주소에 있다. */
+	current->io_ring = parent->io_ring;
+	current->trace = parent->trace;
 	sema_up(&current->fork_sema);
 	process_init ();
 
@@ -259,6 +265,7 @@ process_exec (void *f_name) {
 	/* We first kill the current context */
 	/* 먼저 현재 컨텍스트를 종료합니다. */
 	process_cleanup ();
+	thread_current ()->io_ring = NULL;
 
 	
 	/* And then load the binary */
@@ -322,6 +329,156 @@ process_wait (tid_t child_tid UNUSED) {
 	return child_thread->exit_status;
 }
 
+/* clone 할 때 새 스레드에 넘기는 것. 만든 쪽 스택에 있다. */
+struct clone_args {
+	struct thread *creator;
+	struct intr_frame if_;
+	struct semaphore started;
+};
+
+/* 현재 프로세스의 주소 공간과 fd 테이블을 같이 쓰는 스레드를 만든다.
+ * 새 스레드는 유저 모드 ENTRY 에서 rdi = ARG0, rsi = ARG1 로 시작하고,
+ * rsp 는 STACK 을 16 바이트로 내려 맞춘 뒤 돌아갈 주소 자리 8 바이트를
+ * 뺀 곳이다. 새 스레드의 tid 를, 만들 수 없으면 TID_ERROR 를 돌려준다. */
+tid_t
+process_clone (const struct intr_frame *if_, uintptr_t entry, uint64_t arg0,
+		uint64_t arg1, uintptr_t stack) {
+	struct thread *cur = thread_current ();
+	struct clone_args args;
+	tid_t tid;
+
+	/* 커널 주소나 정규형이 아닌 주소로 iretq 하면 커널에서 폴트가 난다. */
+	if (!is_user_vaddr ((void *) entry) || stack < 16
+			|| !is_user_vaddr ((void *) (stack - 1)))
+		return TID_ERROR;
+	if (cur->proc->group_exiting)
+		return TID_ERROR;
+
+	args.creator = cur;
+	args.if_ = *if_;
+	args.if_.rip = entry;
+	args.if_.R.rdi = arg0;
+	args.if_.R.rsi = arg1;
+	args.if_.R.rax = 0;
+	args.if_.rsp = (stack & ~(uintptr_t) 0xf) - sizeof (void *);
+	sema_init (&args.started, 0);
+
+	tid = thread_create (cur->name, cur->priority, __do_clone, &args);
+	if (tid == TID_ERROR)
+		return TID_ERROR;
+	sema_down (&args.started);
+	return tid;
+}
+
+/* clone 한 스레드의 시작. proc 의 pml4 로 바꾸고 유저 모드로 간다. */
+static void
+__do_clone (void *aux) {
+	struct clone_args *args = aux;
+	struct thread *cur = thread_current ();
+	struct intr_frame if_ = args->if_;
+	enum intr_level old_level;
+
+	cur->proc = args->creator->proc;
+	cur->pml4 = cur->proc->pml4;
+	cur->trace = args->creator->trace;
+	process_activate (cur);
+
+	/* thread_create 가 만든 쪽 child_list 에 넣어 두었으니
+	 * 어느 스레드든 join 할 수 있게 proc 의 clone_list 로 옮긴다. */
+	old_level = intr_disable ();
+	list_remove (&cur->child_elem);
+	list_push_back (&cur->proc->clone_list, &cur->child_elem);
+	intr_set_level (old_level);
+
+	sema_up (&args->started);
+	do_iret (&if_);
+}
+
+/* 끝나기를 기다리던 clone T 를 거두고 exit status 를 돌려준다. */
+static int
+clone_reap (struct thread *t) {
+	int status;
+
+	sema_down (&t->when_use_wait_other_sema);
+	status = t->exit_status;
+	sema_up (&t->when_use_free_curr_sema);
+	return status;
+}
+
+/* 같은 프로세스의 clone 스레드 TID 가 끝나기를 기다려 exit status 를
+ * 돌려준다. 그런 스레드가 없거나, 자기 자신이거나, 이미 다른 스레드가
+ * join 했으면 -1. */
+int
+process_join (tid_t tid) {
+	struct thread *cur = thread_current ();
+	struct list *clones = &cur->proc->clone_list;
+	struct thread *t = NULL;
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	old_level = intr_disable ();
+	for (e = list_begin (clones); e != list_end (clones); e = list_next (e)) {
+		struct thread *c = list_entry (e, struct thread, child_elem);
+		if (c->tid == tid && c != cur) {
+			/* 두 스레드가 같은 clone 을 거두지 않게 미리 뺀다. */
+			list_remove (e);
+			t = c;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+
+	return t != NULL ? clone_reap (t) : -1;
+}
+
+/* PROC 의 clone 이 모두 끝날 때까지 기다렸다 거둔다. 기다리는 동안
+ * 만들어진 clone 도 목록에 들어오므로 빌 때까지 돈다. */
+static void
+reap_clones (struct thread *proc) {
+	for (;;) {
+		struct thread *t = NULL;
+		enum intr_level old_level = intr_disable ();
+
+		if (!list_empty (&proc->clone_list))
+			t = list_entry (list_pop_front (&proc->clone_list),
+					struct thread, child_elem);
+		intr_set_level (old_level);
+		if (t == NULL)
+			break;
+		clone_reap (t);
+	}
+}
+
+/* PROC 의 스레드를 모두 끝내기 시작한다. 처음 부른 쪽의 STATUS 가
+ * 프로세스의 exit status 가 된다. 다른 스레드들은 유저 모드로 돌아가기
+ * 직전에 process_check_exit() 에서 끝나고, futex 에서 자던 스레드는
+ * 여기서 깨운다. */
+void
+process_group_exit (struct thread *proc, int status) {
+	enum intr_level old_level = intr_disable ();
+	bool first = !proc->group_exiting;
+
+	if (first) {
+		proc->group_exiting = true;
+		proc->group_status = status;
+	}
+	intr_set_level (old_level);
+	if (first) {
+		futex_wake_group (proc);
+		fd_table_wake_pipes (proc);
+	}
+}
+
+/* 현재 스레드의 프로세스가 끝나는 중이면 이 스레드도 끝낸다.
+ * 시스템 콜이나 인터럽트에서 유저 모드로 돌아가기 직전에 부른다. */
+void
+process_check_exit (void) {
+	struct thread *cur = thread_current ();
+
+	if (cur->proc->group_exiting)
+		sys_exit (cur->proc->group_status);
+}
+
 /* Exit the process. This function is called by thread_exit (). */
 /* 프로세스를 종료합니다. 이 함수는 thread_exit ()에 의해 호출됩니다. */
 void
@@ -334,16 +491,26 @@ process_exit (void) {
 	/* TODO: 여기에 코드를 작성하세요.
 	 * TODO: 프로세스 종료 메시지를 구현합니다 (project2/process_termination.html 참조).
 	 * TODO: 여기에 프로세스 자원 정리를 구현하는 것을 권장합니다. */
+	palloc_free_page (curr->bounce);
+	curr->bounce = NULL;
+
+	/* clone 한 스레드는 proc 의 자원을 건드리지 않고 자기만 끝난다.
+	 * 거둔 뒤 proc 이 pml4 를 없앨 수 있으니 먼저 놓아 둔다. */
+	if (curr->proc != curr) {
+		curr->pml4 = NULL;
+		pml4_activate (NULL);
+		sema_up(&curr->when_use_wait_other_sema);
+		sema_down(&curr->when_use_free_curr_sema);
+		return;
+	}
+
+	/* 같이 쓰는 주소 공간과 fd 테이블은 clone 이 모두 끝난 뒤 정리한다.
+	 * 아직 도는 clone 은 유저 모드로 돌아가기 전에 끝나게 한다. */
+	process_group_exit(curr, curr->exit_status);
+	reap_clones(curr);
+
 	/* 파일 디스크립터 테이블 정리 */
-    if (curr->fd_table != NULL) {
-        for (size_t i = 2; i < INT8_MAX; i++) {
-            if (curr->fd_table[i] != NULL) {
-                file_close(curr->fd_table[i]);
-            }
-        }
-        
-		palloc_free_multiple(curr->fd_table, 2);
-    }
+	fd_table_destroy(curr);
 
 	
     /* 실행 중인 파일 닫기 */
@@ -862,6 +1029,27 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* TODO: Load the segment from the file */
 	/* TODO: This called when the first page fault occurs on address VA. */
 	/* TODO: VA is available when calling this function. */
+	struct lazy_load_info *info = aux;
+	uint8_t *kva = page->frame->kva;
+	bool held = lock_held_by_current_thread (&filesys_lock);
+	bool success = true;
+
+	/* fault-around 가 이웃 페이지와 한 번에 읽어 두었으면 0 만 채운다. */
+	if (!info->prefilled) {
+		/* 시스템 콜 도중(filesys_lock 을 잡은 채) 폴트가 날 수도 있다. */
+		if (!held)
+			lock_acquire (&filesys_lock);
+		success = file_read_at (info->file, kva, info->read_bytes, info->ofs)
+				== (off_t) info->read_bytes;
+		if (!held)
+			lock_release (&filesys_lock);
+	}
+
+	if (success)
+		memset (kva + info->read_bytes, 0, info->zero_bytes);
+	file_close (info->file);
+	free (info);
+	return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -893,15 +1081,28 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
+		struct lazy_load_info *aux = malloc (sizeof *aux);
+		if (aux == NULL)
 			return false;
+		aux->file = file_reopen (file);
+		aux->ofs = ofs;
+		aux->read_bytes = page_read_bytes;
+		aux->zero_bytes = page_zero_bytes;
+		aux->map_addr = NULL;
+		aux->prefilled = false;
+		if (aux->file == NULL
+				|| !vm_alloc_page_with_initializer (VM_ANON | VM_FILE_LOAD, upage,
+					writable, lazy_load_segment, aux)) {
+			file_close (aux->file);
+			free (aux);
+			return false;
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		upage += PGSIZE;
+		ofs += page_read_bytes;
 	}
 	return true;
 }
@@ -916,6 +1117,12 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
+	if (vm_alloc_page (VM_ANON | VM_STACK, stack_bottom, true)
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		thread_current ()->stack_bottom = stack_bottom;
+		success = true;
+	}
 
 	return success;
 }
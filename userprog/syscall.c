@@ -1,34 +1,64 @@
 #include "userprog/syscall.h"
+#include <inttypes.h>
+#include <limits.h>
+#include <futex.h>
+#include <ioring.h>
 #include <stdio.h>
+#include <string.h>
 #include "lib/stdio.h"
 #include <syscall-nr.h>
+#include <syscall-stat.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/pipe.h"
+#include "userprog/futex.h"
 #include "userprog/process.h"
+#include "userprog/trace.h"
+#include "userprog/uaccess.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 struct lock local_lock;
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
-void check_address (void *addr);
+static bool copy_in_name (char name[NAME_MAX + 1], const char *uname);
 bool fd_is_valid(int fd);
 bool file_is_valid(char *file);
 
 struct file *get_file_from_fd (int fd);
 int add_file_to_fd_table (struct file *file);
+struct file *remove_fd (int fd);
 
 bool sys_create(const char *file, unsigned initial_size);
 int sys_open(const char *file);
 int sys_filesize (int fd);
 int sys_read (int fd, void *buffer, unsigned length);
 int sys_write(int fd, const void *buffer, unsigned size);
+int sys_pread (int fd, void *buffer, unsigned length, off_t offset);
+int sys_pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+struct iovec;
+int sys_readv (int fd, const struct iovec *iov, int iovcnt);
+int sys_writev (int fd, const struct iovec *iov, int iovcnt);
+int sys_copy_file_range (int in_fd, int out_fd, unsigned length);
+int sys_ring_setup (struct io_ring *ring);
+int sys_ring_enter (unsigned to_submit);
+int sys_syscall_stat (int nr, struct syscall_stat *st);
+int sys_trace_ctl (int pid, bool on);
+int sys_trace_read (struct trace_rec *buf, unsigned cnt);
+int sys_pipe (int *fds);
+int sys_dup2 (int oldfd, int newfd);
+int sys_futex (uint32_t *addr, int op, uint32_t val);
 bool sys_remove (const char *file);
 void sys_close(int fd);
 void sys_exit(int status);
@@ -36,6 +66,10 @@ void sys_halt(void);
 void sys_seek (int fd, unsigned position);
 unsigned sys_tell (int fd);
 int sys_exec (const char *cmd_line);
+#ifdef VM
+void *sys_mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void sys_munmap (void *addr);
+#endif
 
 
 void lock_acquire_if_available(const struct lock *lock);
@@ -68,108 +102,354 @@ syscall_init (void) {
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 	lock_init(&filesys_lock);
-	
+	trace_init();
+	futex_init();
+}
+
+pid_t fork (const char *thread_name);
+int wait (pid_t tid);
+
+/* 시스템 콜 하나를 부른다. 인자는 F 의 레지스터에서 꺼내고
+ * rax 에 넣을 값을 돌려준다.
+ *
+ * syscall_handler를 호출할 때 이미 인터럽트 프레임에
+ * 해당 시스템 콜 넘버에 맞는 인자 수만큼 들어있다.
+ * 이때 rdi, rsi, ...얘네들은 특정 값이 있는 게 아니라 그냥 인자를 담는 그릇의 번호 순서이다.
+ * 첫번째 인자면 rdi, 두번째 인자면 rsi, 그 다음 rdx, r10, r8 순서. */
+typedef uint64_t syscall_func (struct intr_frame *f);
+
+static uint64_t sc_halt (struct intr_frame *f UNUSED) { sys_halt(); NOT_REACHED(); }
+/* clone 한 스레드가 exit 하면 그 스레드만 끝나고 status 는 join 이 받는다.
+ * 주인의 exit 이나 커널이 죽이는 sys_exit() 는 프로세스 전체를 끝낸다. */
+static uint64_t sc_exit (struct intr_frame *f)
+{
+	struct thread *t = thread_current();
+
+	if (t->proc != t && !t->proc->group_exiting)
+	{
+		t->exit_status = f->R.rdi;
+		thread_exit();
+	}
+	sys_exit(f->R.rdi);
+	NOT_REACHED();
+}
+static uint64_t sc_fork (struct intr_frame *f)
+{
+	thread_current()->pre_if = f;
+	return fork(f->R.rdi);
+}
+static uint64_t sc_exec (struct intr_frame *f) { return sys_exec(f->R.rdi); }
+static uint64_t sc_wait (struct intr_frame *f) { return wait(f->R.rdi); }
+static uint64_t sc_create (struct intr_frame *f) { return sys_create(f->R.rdi, f->R.rsi); }
+static uint64_t sc_remove (struct intr_frame *f) { return sys_remove(f->R.rdi); }
+static uint64_t sc_open (struct intr_frame *f) { return sys_open(f->R.rdi); }
+static uint64_t sc_filesize (struct intr_frame *f) { return sys_filesize(f->R.rdi); }
+static uint64_t sc_read (struct intr_frame *f) { return sys_read(f->R.rdi, f->R.rsi, f->R.rdx); }
+static uint64_t sc_write (struct intr_frame *f) { return sys_write(f->R.rdi, f->R.rsi, f->R.rdx); }
+static uint64_t sc_seek (struct intr_frame *f) { sys_seek(f->R.rdi, f->R.rsi); return 0; }
+static uint64_t sc_tell (struct intr_frame *f) { return sys_tell(f->R.rdi); }
+static uint64_t sc_close (struct intr_frame *f) { sys_close(f->R.rdi); return 0; }
+static uint64_t sc_readv (struct intr_frame *f)
+{
+	return sys_readv(f->R.rdi, (const struct iovec *) f->R.rsi, f->R.rdx);
+}
+static uint64_t sc_writev (struct intr_frame *f)
+{
+	return sys_writev(f->R.rdi, (const struct iovec *) f->R.rsi, f->R.rdx);
+}
+static uint64_t sc_pread (struct intr_frame *f)
+{
+	return sys_pread(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+}
+static uint64_t sc_pwrite (struct intr_frame *f)
+{
+	return sys_pwrite(f->R.rdi, (const void *) f->R.rsi, f->R.rdx, f->R.r10);
+}
+static uint64_t sc_copy_file_range (struct intr_frame *f)
+{
+	return sys_copy_file_range(f->R.rdi, f->R.rsi, f->R.rdx);
+}
+static uint64_t sc_ring_setup (struct intr_frame *f)
+{
+	return sys_ring_setup((struct io_ring *) f->R.rdi);
+}
+static uint64_t sc_ring_enter (struct intr_frame *f) { return sys_ring_enter(f->R.rdi); }
+static uint64_t sc_syscall_stat (struct intr_frame *f)
+{
+	return sys_syscall_stat(f->R.rdi, (struct syscall_stat *) f->R.rsi);
+}
+static uint64_t sc_pipe (struct intr_frame *f) { return sys_pipe((int *) f->R.rdi); }
+static uint64_t sc_dup2 (struct intr_frame *f) { return sys_dup2(f->R.rdi, f->R.rsi); }
+static uint64_t sc_futex (struct intr_frame *f)
+{
+	return sys_futex((uint32_t *) f->R.rdi, f->R.rsi, f->R.rdx);
+}
+static uint64_t sc_clone (struct intr_frame *f)
+{
+	return process_clone(f, f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+}
+static uint64_t sc_join (struct intr_frame *f) { return process_join(f->R.rdi); }
+static uint64_t sc_trace_ctl (struct intr_frame *f) { return sys_trace_ctl(f->R.rdi, f->R.rsi); }
+static uint64_t sc_trace_read (struct intr_frame *f)
+{
+	return sys_trace_read((struct trace_rec *) f->R.rdi, f->R.rsi);
+}
+#ifdef VM
+static uint64_t sc_mmap (struct intr_frame *f)
+{
+	return (uint64_t) sys_mmap((void *) f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+}
+static uint64_t sc_munmap (struct intr_frame *f)
+{
+	sys_munmap((void *) f->R.rdi);
+	return 0;
+}
+#endif
+
+/* 반환값으로 실패를 알아보는 방법 */
+enum syscall_err {
+	ERR_NONE,                   /* 실패를 돌려주지 않는다 */
+	ERR_NEG,                    /* 음수면 실패 */
+	ERR_FALSE,                  /* false 면 실패 */
+	ERR_NULL,                   /* NULL 이면 실패 */
+};
+
+struct syscall_desc {
+	const char *name;
+	syscall_func *func;
+	enum syscall_err err;
+};
+
+/* SYS_* 번호로 찾는 시스템 콜 표. 비어 있는 칸은 없는 시스템 콜. */
+static const struct syscall_desc syscall_table[] = {
+	[SYS_HALT]            = { "halt",            sc_halt,            ERR_NONE },
+	[SYS_EXIT]            = { "exit",            sc_exit,            ERR_NONE },
+	[SYS_FORK]            = { "fork",            sc_fork,            ERR_NEG },
+	[SYS_EXEC]            = { "exec",            sc_exec,            ERR_NEG },
+	[SYS_WAIT]            = { "wait",            sc_wait,            ERR_NEG },
+	[SYS_CREATE]          = { "create",          sc_create,          ERR_FALSE },
+	[SYS_REMOVE]          = { "remove",          sc_remove,          ERR_FALSE },
+	[SYS_OPEN]            = { "open",            sc_open,            ERR_NEG },
+	[SYS_FILESIZE]        = { "filesize",        sc_filesize,        ERR_NEG },
+	[SYS_READ]            = { "read",            sc_read,            ERR_NEG },
+	[SYS_WRITE]           = { "write",           sc_write,           ERR_NEG },
+	[SYS_SEEK]            = { "seek",            sc_seek,            ERR_NONE },
+	[SYS_TELL]            = { "tell",            sc_tell,            ERR_NONE },
+	[SYS_CLOSE]           = { "close",           sc_close,           ERR_NONE },
+#ifdef VM
+	[SYS_MMAP]            = { "mmap",            sc_mmap,            ERR_NULL },
+	[SYS_MUNMAP]          = { "munmap",          sc_munmap,          ERR_NONE },
+#endif
+	[SYS_DUP2]            = { "dup2",            sc_dup2,            ERR_NEG },
+	[SYS_READV]           = { "readv",           sc_readv,           ERR_NEG },
+	[SYS_WRITEV]          = { "writev",          sc_writev,          ERR_NEG },
+	[SYS_PREAD]           = { "pread",           sc_pread,           ERR_NEG },
+	[SYS_PWRITE]          = { "pwrite",          sc_pwrite,          ERR_NEG },
+	[SYS_COPY_FILE_RANGE] = { "copy_file_range", sc_copy_file_range, ERR_NEG },
+	[SYS_RING_SETUP]      = { "ring_setup",      sc_ring_setup,      ERR_NEG },
+	[SYS_RING_ENTER]      = { "ring_enter",      sc_ring_enter,      ERR_NEG },
+	[SYS_SYSCALL_STAT]    = { "syscall_stat",    sc_syscall_stat,    ERR_NEG },
+	[SYS_TRACE_CTL]       = { "trace_ctl",       sc_trace_ctl,       ERR_NEG },
+	[SYS_TRACE_READ]      = { "trace_read",      sc_trace_read,      ERR_NEG },
+	[SYS_PIPE]            = { "pipe",            sc_pipe,            ERR_NEG },
+	[SYS_FUTEX]           = { "futex",           sc_futex,           ERR_NEG },
+	[SYS_CLONE]           = { "clone",           sc_clone,           ERR_NEG },
+	[SYS_JOIN]            = { "join",            sc_join,            ERR_NEG },
+};
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* 시스템 콜마다의 통계. 인터럽트를 끄고 고친다. */
+static struct syscall_stat syscall_stats[SYSCALL_CNT];
+
+static bool syscall_failed (enum syscall_err err, uint64_t ret)
+{
+	switch (err)
+	{
+	case ERR_NEG:
+		return (int) ret < 0;
+	case ERR_FALSE:
+	case ERR_NULL:
+		return ret == 0;
+	default:
+		return false;
+	}
+}
+
+/* 돌아온 시스템 콜 NR 의 결과 RET 와 걸린 사이클 CYCLES 를 센다. */
+static void syscall_account (unsigned nr, uint64_t ret, uint64_t cycles)
+{
+	struct syscall_stat *st = &syscall_stats[nr];
+	int bucket = cycles ? 63 - __builtin_clzll(cycles) : 0;
+	enum intr_level old_level;
+
+	if (bucket >= SYSCALL_HIST_BUCKETS)
+		bucket = SYSCALL_HIST_BUCKETS - 1;
+	old_level = intr_disable();
+	if (syscall_failed(syscall_table[nr].err, ret))
+		st->errors++;
+	st->cycles += cycles;
+	st->hist[bucket]++;
+	intr_set_level(old_level);
 }
 
 /* The main system call interface */
-/*syscall_handler를 호출할 때 이미 인터럽트 프레임에 
-해당 시스템 콜 넘버에 맞는 인자 수만큼 들어있다. 
-그러니 각 함수별로 필요한 인자 수만큼 인자를 넣어준다. 
-이때 rdi, rsi, ...얘네들은 특정 값이 있는 게 아니라 그냥 인자를 담는 그릇의 번호 순서이다. 
-어떤 특정 인자와 매칭되는 게 아니라 
-첫번째 인자면 rdi, 두번째 인자면 rsi 이런 식이니 헷갈리지 말 것.
-*/
+/* rax 의 번호로 표에서 시스템 콜을 찾아 부르고 횟수, 실패, 걸린
+ * 시간을 센다. trace 가 켜진 프로세스면 trace 버퍼에도 남긴다.
+ * 없는 번호면 -1 을 돌려준다. */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
-	int sys_number = f->R.rax;
+	uint64_t nr = f->R.rax;
+	enum intr_level old_level;
+	uint64_t start, ret, cycles;
+#ifdef VM
+	/* 커널 안에서 유저 스택 폴트가 나면 이 값으로 스택 접근인지 판단 */
+	thread_current ()->user_rsp = f->rsp;
+#endif
 
-	switch (sys_number)
-	{
-	case SYS_HALT: 							// 운영체제 종료
-		sys_halt();
-		break;
-	case SYS_EXIT:							// 프로그램 종료 후 상태 반환
-		sys_exit(f->R.rdi);
-		break;
-	case SYS_FORK:							// 자식 프로세스 생성
-		thread_current()->pre_if = f;
-		f->R.rax = fork(f->R.rdi);
-		break;
-	case SYS_EXEC:							// 새 프로그램 실행
-		f->R.rax = sys_exec(f->R.rdi);
-		break;
-	case SYS_WAIT:							// 자식 프로세스가 종료될 때까지 기다림
-		f->R.rax = wait(f->R.rdi);		
-		break;
-	case SYS_CREATE:
-        f->R.rax = sys_create(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_REMOVE:						// 파일 삭제
-		 f->R.rax = sys_remove(f->R.rdi);
-		break;
-	case SYS_OPEN:							// 파일 열기
-		f->R.rax = sys_open(f->R.rdi);
-		break;
-	case SYS_FILESIZE:						// 파일 사이즈 반환
-		f->R.rax = sys_filesize(f->R.rdi);
-		break;
-	case SYS_READ:							// 파일에서 데이터 읽기
-		f->R.rax = sys_read(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_WRITE:							// 파일에 데이터 쓰기
-		f->R.rax = sys_write(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_SEEK:							// 파일의 읽기/쓰기 포인터 이동
-		sys_seek(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_TELL:							// 파일의 현재 읽기/쓰기 데이터 반환
-		sys_tell(f->R.rdi);
-		break;
-	case SYS_CLOSE:							// 파일 닫기
-		sys_close(f->R.rdi);
-		break;
-	}
-	// printf ("system call!\n");
-	// struct thread *t = thread_current();
-	// printf("thread name:%s\n",t->name);
-	// thread_exit ();
-}
-
-/*User memory access는 이후 시스템 콜 구현할 때 메모리에 접근할 텐데, 
-이때 접근하는 메모리 주소가 유저 영역인지 커널 영역인지를 체크*/
-void check_address (void *addr)
+	if (nr >= SYSCALL_CNT || syscall_table[nr].func == NULL) {
+		f->R.rax = -1;
+		return;
+	}
+
+	/* exit 처럼 돌아오지 않는 호출도 있으니 횟수는 먼저 센다. */
+	old_level = intr_disable ();
+	syscall_stats[nr].calls++;
+	intr_set_level (old_level);
+
+	start = rdtsc ();
+	ret = syscall_table[nr].func (f);
+	cycles = rdtsc () - start;
+	f->R.rax = ret;
+	syscall_account (nr, ret, cycles);
+	if (thread_current ()->trace)
+		trace_log (thread_current ()->tid, nr, f, ret, cycles);
+	process_check_exit ();
+}
+
+/* 시스템 콜 NR 의 통계를 유저 버퍼 ST 에 복사한다. */
+int sys_syscall_stat (int nr, struct syscall_stat *st)
 {
-	struct thread *t = thread_current();
-	
-	/*포인터가 가리키는 주소가 유저영역의 주소인지 확인 
-	|| 포인터가 가리키는 주소가 유저 영역 내에 있지만 
-	페이지로 할당하지 않은 영역일수도 잇으니 체크*/
-	if (!is_user_vaddr(addr) || addr == NULL || pml4_get_page(t->pml4, addr) == NULL){ 	
-		sys_exit(-1);	// 잘못된 접근일 경우 프로세스 종료
+	struct syscall_stat snap;
+	enum intr_level old_level;
+
+	if (nr < 0 || (unsigned) nr >= SYSCALL_CNT || syscall_table[nr].func == NULL)
+		return -1;
+	old_level = intr_disable();
+	snap = syscall_stats[nr];
+	intr_set_level(old_level);
+	if (!copy_to_user(st, &snap, sizeof snap))
+		sys_exit(-1);
+	return 0;
+}
+
+/* PID 프로세스의 시스템 콜 trace 를 켜거나 끈다. PID 가 0 이면
+ * 자기 자신이고 아니면 자식이어야 한다. fork 한 자식은 이어받고
+ * exec 해도 유지된다. */
+int sys_trace_ctl (int pid, bool on)
+{
+	struct thread *t = pid == 0 ? thread_current() : get_child_thread(pid);
+
+	if (t == NULL)
+		return -1;
+	t->trace = on;
+	return 0;
+}
+
+/* trace 버퍼에서 아직 읽지 않은 기록을 CNT 개까지 BUF 로 읽는다. */
+int sys_trace_read (struct trace_rec *buf, unsigned cnt)
+{
+	int n = trace_read(buf, cnt);
+
+	if (n < 0)
+		sys_exit(-1);
+	return n;
+}
+
+/* 유저 락용 대기 큐. OP 가 FUTEX_WAIT 면 *ADDR 이 VAL 일 때 잠들고,
+ * FUTEX_WAKE 면 ADDR 에서 자는 스레드를 VAL 개까지 깨운다. ADDR 는
+ * 4 바이트 정렬된 쓸 수 있는 주소여야 한다. */
+int sys_futex (uint32_t *addr, int op, uint32_t val)
+{
+	switch (op)
+	{
+	case FUTEX_WAIT:
+		return futex_wait(addr, val);
+	case FUTEX_WAKE:
+		return futex_wake(addr, val);
+	default:
+		return -1;
+	}
+}
+
+/* 한 번이라도 불린 시스템 콜의 통계를 출력한다. 히스토그램은
+ * 비어 있지 않은 칸만 "log2(사이클):횟수" 로 찍는다. */
+void
+syscall_print_stats (void) {
+	for (unsigned nr = 0; nr < SYSCALL_CNT; nr++) {
+		const struct syscall_stat *st = &syscall_stats[nr];
+		uint64_t returned = 0;
+
+		if (st->calls == 0)
+			continue;
+		for (int i = 0; i < SYSCALL_HIST_BUCKETS; i++)
+			returned += st->hist[i];
+		printf ("Syscall: %-15s %"PRIu64" calls, %"PRIu64" errors, "
+				"%"PRIu64" avg cycles\n",
+				syscall_table[nr].name, st->calls, st->errors,
+				returned ? st->cycles / returned : 0);
+		if (returned == 0)
+			continue;
+		printf ("  cycles:");
+		for (int i = 0; i < SYSCALL_HIST_BUCKETS; i++)
+			if (st->hist[i] != 0)
+				printf (" %d:%"PRIu64, i, st->hist[i]);
+		printf ("\n");
 	}
 }
 
+/* 유저 파일 이름 UNAME 을 NAME 으로 복사한다. 주소가 잘못됐으면
+ * 프로세스를 끝낸다. NAME_MAX 보다 길면 false (그런 파일은 만들 수도
+ * 열 수도 없다). */
+static bool copy_in_name (char name[NAME_MAX + 1], const char *uname)
+{
+	long len = strncpy_from_user(name, uname, NAME_MAX + 1);
+
+	if (len < 0)
+		sys_exit(-1);
+	return len <= NAME_MAX;
+}
+
 /* file 만들기 */
 bool sys_create(const char *file, unsigned initial_size)
 {
-	check_address(file);
-	if(!file_is_valid(file))
-		sys_exit(-1);
+	char name[NAME_MAX + 1];
+
+	if(!copy_in_name(name, file))
+		return false;
 	lock_acquire_if_available(&filesys_lock);
-	bool result = filesys_create(file, initial_size);
+	bool result = filesys_create(name, initial_size);
 	lock_release_if_available(&filesys_lock);
 	return result;
 }
 
 
 /* file 열기 */
+static int open_name (const char *name);
+
 int sys_open(const char *file)
 {
-	
-	check_address((void *)file);
+	char name[NAME_MAX + 1];
 
+	if(!copy_in_name(name, file))
+		return -1;
+	return open_name(name);
+}
+
+/* 커널에 복사해 온 이름 NAME 의 파일을 열고 fd 를 준다. */
+static int open_name (const char *name)
+{
 	lock_acquire_if_available(&filesys_lock);
-	struct file *f = filesys_open(file);
+	struct file *f = filesys_open(name);
 	lock_release_if_available(&filesys_lock);
 
 	if(f == NULL) {
@@ -197,154 +477,445 @@ int sys_filesize (int fd)
 	return file_length(f);
 }
 
-/* file 읽기 */
-int sys_read (int fd, void *buffer, unsigned length)
+/* 유저 iovec. lib/user/syscall.h 의 struct iovec 와 같은 모양이다. */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+/* readv/writev 한 번에 받는 iovec 수 상한 */
+#define IOV_MAX 1024
+
+/* 아래 두 함수는 유저 버퍼와 파일 사이를 곧바로 잇지 않고 커널 페이지
+ * KBUF 를 거친다. 유저 페이지를 건드리면 폴트가 나서 lazy load 나 스왑,
+ * mmap 의 write-back 처럼 filesys_lock 이 필요한 일이 생길 수 있는데,
+ * filesys_lock 을 잡은 채로 그러면 같은 락을 다시 잡게 되거나 다른 락과
+ * 순서가 엇갈린다. 그래서 유저 메모리는 락 밖에서만 copy_to_user /
+ * copy_from_user 로 건드리고, 락 안에서는 KBUF 만 쓴다. 대신 페이지마다
+ * memcpy 가 한 번 더 들고 KBUF 로 한 페이지를 잡아 둔다. */
+
+/* FILE 에서 LENGTH 바이트를 유저 BUFFER 로 읽는다. FILE 이 NULL 이면
+ * 표준 입력. POS 가 NULL 이면 파일 위치에서 읽고, 아니면 *POS 에서 읽고
+ * *POS 를 읽은 만큼 늘린다. 커널 페이지 KBUF 에 읽은 뒤 copy_to_user
+ * 로 옮긴다. 유저 버퍼가 잘못됐으면 -1 이고, 부른 쪽이 프로세스를
+ * 끝낸다. 파이프는 POS 없이만 읽고, 읽은 게 있으면 바로 돌아온다. */
+static int read_to_user (struct file *file, void *buffer, unsigned length,
+		off_t *pos, uint8_t *kbuf)
 {
-	check_address(buffer);
-	// lock_acquire(&filesys_lock);
-	if(!fd_is_valid(fd))
-	{
-		// lock_release(&filesys_lock);
-		sys_exit(-1);
+	unsigned total = 0;
+
+	if (!uaccess_ok(buffer, length))
 		return -1;
-	}
+	while (total < length)
+	{
+		unsigned chunk = length - total < PGSIZE ? length - total : PGSIZE;
+		bool pipe = file != NULL && file_is_pipe(file);
+		unsigned n;
+
+		/* 파이프는 기다릴 수 있으니 filesys_lock 을 잡지 않는다. */
+		if (pipe)
+			n = pipe_read(file_get_pipe(file, false), kbuf, chunk);
+		else
+		{
+			lock_acquire_if_available(&filesys_lock);
+			if (file == NULL)	// 표준 입력
+			{
+				for (n = 0; n < chunk; n++)
+					kbuf[n] = input_getc();
+			}
+			else if (pos != NULL)
+				n = file_read_at(file, kbuf, chunk, *pos);
+			else
+				n = file_read(file, kbuf, chunk);
+			lock_release_if_available(&filesys_lock);
+		}
 
+		if (!copy_to_user((uint8_t *) buffer + total, kbuf, n))
+			return -1;
+		total += n;
+		if (pos != NULL)
+			*pos += n;
+		if (n < chunk || pipe)
+			break;
+	}
+	return total;
+}
 
-	// lock_acquire(&filesys_lock);
-	unsigned i;
+/* 유저 BUFFER 의 SIZE 바이트를 FILE 에 쓴다. FILE 이 NULL 이면 표준
+ * 출력. POS 는 read_to_user 와 같다. 읽는 쪽이 모두 닫힌 파이프에
+ * 하나도 못 썼으면 잘못된 버퍼처럼 -1 이라서, SIGPIPE 의 기본 동작
+ * 처럼 프로세스가 끝난다. */
+static int write_from_user (struct file *file, const void *buffer,
+		unsigned size, off_t *pos, uint8_t *kbuf)
+{
+	unsigned total = 0;
 
-	switch (fd)
+	if (!uaccess_ok(buffer, size))
+		return -1;
+	while (total < size)
 	{
-	case STDIN_FILENO:
-		lock_acquire_if_available(&filesys_lock);
-        i = input_getc();
-		lock_release_if_available(&filesys_lock);
-		break;
-	case STDOUT_FILENO:
-		i = -1;
-		break;
+		unsigned chunk = size - total < PGSIZE ? size - total : PGSIZE;
+		unsigned n;
 
-	default:
+		if (!copy_from_user(kbuf, (const uint8_t *) buffer + total, chunk))
+			return -1;
+
+		if (file != NULL && file_is_pipe(file))
+		{
+			int written = pipe_write(file_get_pipe(file, true), kbuf, chunk);
+
+			if (written < 0)
+				return total > 0 ? (int) total : -1;
+			n = written;
+		}
+		else
 		{
-			// 파일에서 읽기
-        	struct file *file = get_file_from_fd(fd);
-        	if (file == NULL)
+			lock_acquire_if_available(&filesys_lock);
+			if (file == NULL)	// 표준 출력
 			{
-				printf("sys_read()파일이 없음\n");
-				// lock_release(&filesys_lock);
-				return -1;
+				putbuf((const char *) kbuf, chunk);
+				n = chunk;
 			}
-			lock_acquire_if_available(&filesys_lock);
-			i = file_read(file, buffer, length);
+			else if (pos != NULL)
+				n = file_write_at(file, kbuf, chunk, *pos);
+			else
+				n = file_write(file, kbuf, chunk);
 			lock_release_if_available(&filesys_lock);
 		}
-		break;
-	}
-	// lock_release(&filesys_lock);
-	return i;
-    // if (fd == STDIN_FILENO)//표준입력 받기
-	// {
-    //     unsigned i;
-	// 	lock_acquire(&filesys_lock);
-    //     for (i = 0; i < length; i++)
-	// 	{
-    //         ((uint8_t *)buffer)[i] = input_getc();
-    //     }
-	// 	lock_release(&filesys_lock);
-    //     return i;
-    // } 
-	// else if(fd == STDOUT_FILENO) {
-	// 	// lock_release(&filesys_lock);
-	// 	return -1;
-	// }
-	// else if (fd > 1 && fd < INT8_MAX) 
-	// {
-    //     // 파일에서 읽기
-    //     struct file *file = get_file_from_fd(fd);
-    //     if (file == NULL){
-	// 		// lock_release(&filesys_lock);
-	// 		return -1;
-	// 	}
-    //     lock_acquire(&filesys_lock);
-	// 	int bytes_read = file_read(file, buffer, length);
-	// 	lock_release(&filesys_lock);
-    //     if (bytes_read < 0) {
-	// 		// lock_release(&filesys_lock);
-	// 		return -1;
-	// 	}
-	// 	// lock_release(&filesys_lock);
-    //     return bytes_read;
-    // }
-	// // lock_release(&filesys_lock);
-    // return -1;  // 기본적으로 실패 반환
+
+		total += n;
+		if (pos != NULL)
+			*pos += n;
+		if (n < chunk)
+			break;
+	}
+	return total;
+}
+
+/* read/write 류가 유저 버퍼를 옮겨 담는 현재 스레드의 커널 페이지.
+ * 처음 쓸 때 한 번만 받아 두고 process_exit() 에서 푼다. 메모리가
+ * 없으면 NULL. */
+static uint8_t *bounce_page (void)
+{
+	struct thread *t = thread_current();
+
+	if (t->bounce == NULL)
+		t->bounce = palloc_get_page(0);
+	return t->bounce;
+}
+
+/* FD 를 읽기용으로 푼다. 콘솔 표준 입력이면 *FILE 은 NULL. 읽을 수
+ * 없는 fd 면 false. 음수 fd 는 프로세스를 끝낸다. dup2 로 0 에 붙인
+ * 파일이 있으면 그 파일이다. */
+static bool fd_for_read (int fd, struct file **file)
+{
+	if (!fd_is_valid(fd))
+		sys_exit(-1);
+	*file = get_file_from_fd(fd);
+	if (*file == NULL)
+		return fd == STDIN_FILENO;
+	return file_get_pipe(*file, true) == NULL;	// 파이프 쓰기 끝은 못 읽는다
+}
+
+/* FD 를 쓰기용으로 푼다. 콘솔 표준 출력이면 *FILE 은 NULL. */
+static bool fd_for_write (int fd, struct file **file)
+{
+	if (!fd_is_valid(fd))
+		sys_exit(-1);
+	*file = get_file_from_fd(fd);
+	if (*file == NULL)
+		return fd == STDOUT_FILENO;
+	return file_get_pipe(*file, false) == NULL;	// 파이프 읽기 끝에는 못 쓴다
+}
+
+/* file 읽기 */
+int sys_read (int fd, void *buffer, unsigned length)
+{
+	struct file *file;
+	uint8_t *kbuf;
+	int result;
+
+	if (!fd_for_read(fd, &file))
+		return -1;
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+	result = read_to_user(file, buffer, length, NULL, kbuf);
+	if (result < 0)
+		sys_exit(-1);
+	return result;
 }
 
 /* file 쓰기 */
 int sys_write(int fd, const void *buffer, unsigned size)
 {
-	check_address(buffer);
-	// lock_acquire(&filesys_lock);
-	if(!fd_is_valid(fd))
-	{
-		// lock_release(&filesys_lock);
+	struct file *file;
+	uint8_t *kbuf;
+	int result;
+
+	if (!fd_for_write(fd, &file))
+		return -1;
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+	result = write_from_user(file, buffer, size, NULL, kbuf);
+	if (result < 0)
+		sys_exit(-1);
+	return result;
+}
+
+/* OFFSET 위치에서 읽는다. 파일 위치는 바뀌지 않는다. */
+int sys_pread (int fd, void *buffer, unsigned length, off_t offset)
+{
+	struct file *file;
+	uint8_t *kbuf;
+	int result;
+
+	if (!fd_for_read(fd, &file) || file == NULL || file_is_pipe(file)
+			|| offset < 0)
+		return -1;
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+	result = read_to_user(file, buffer, length, &offset, kbuf);
+	if (result < 0)
+		sys_exit(-1);
+	return result;
+}
+
+/* OFFSET 위치에 쓴다. 파일 위치는 바뀌지 않는다. */
+int sys_pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+	struct file *file;
+	uint8_t *kbuf;
+	int result;
+
+	if (!fd_for_write(fd, &file) || file == NULL || file_is_pipe(file)
+			|| offset < 0)
+		return -1;
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+	result = write_from_user(file, buffer, size, &offset, kbuf);
+	if (result < 0)
 		sys_exit(-1);
+	return result;
+}
+
+/* 유저 iovec 배열 UIOV 의 IOVCNT 개를 차례로 읽거나 쓴다. iovec 은
+ * 한 페이지씩 복사해 오고, 데이터용 페이지 하나를 모든 버퍼에 같이
+ * 쓴다. 중간에 짧게 끝나면 거기서 멈추고 지금까지의 합을 돌려준다. */
+static int rw_vector (int fd, const struct iovec *uiov, int iovcnt, bool write)
+{
+	struct file *file;
+	struct iovec *iov;
+	uint8_t *kbuf;
+	int total = 0;
+
+	if (!(write ? fd_for_write(fd, &file) : fd_for_read(fd, &file)))
+		return -1;
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+		return -1;
+	if ((iov = palloc_get_page(0)) == NULL)
 		return -1;
+	if ((kbuf = bounce_page()) == NULL)
+	{
+		palloc_free_page(iov);
+		return -1;
+	}
+
+	const int per_page = PGSIZE / sizeof *iov;
+	for (int base = 0; base < iovcnt; base += per_page)
+	{
+		int cnt = iovcnt - base < per_page ? iovcnt - base : per_page;
+
+		if (!copy_from_user(iov, uiov + base, cnt * sizeof *iov))
+			goto fault;
+		for (int i = 0; i < cnt; i++)
+		{
+			unsigned len = iov[i].iov_len;
+			int n;
+
+			if (len != iov[i].iov_len || total + len < (unsigned) total
+					|| total + len > INT_MAX)
+				goto done;
+			n = write ? write_from_user(file, iov[i].iov_base, len, NULL, kbuf)
+				: read_to_user(file, iov[i].iov_base, len, NULL, kbuf);
+			if (n < 0)
+				goto fault;
+			total += n;
+			if ((unsigned) n < len)
+				goto done;
+		}
 	}
+done:
+	palloc_free_page(iov);
+	return total;
+
+fault:
+	palloc_free_page(iov);
+	sys_exit(-1);
+	NOT_REACHED();
+}
+
+/* 여러 버퍼로 읽기 */
+int sys_readv (int fd, const struct iovec *iov, int iovcnt)
+{
+	return rw_vector(fd, iov, iovcnt, false);
+}
 
-	
+/* 여러 버퍼에서 쓰기 */
+int sys_writev (int fd, const struct iovec *iov, int iovcnt)
+{
+	return rw_vector(fd, iov, iovcnt, true);
+}
 
-	switch (fd)
+/* IN_FD 의 현재 위치에서 LENGTH 바이트를 OUT_FD 의 현재 위치로 커널
+ * 안에서 옮기고 두 위치를 옮긴 만큼 늘린다. OUT_FD 가 표준 출력이면
+ * 콘솔로 보낸다. 데이터는 커널 페이지 하나만 거치고 유저 메모리에는
+ * 닿지 않는다. 같은 파일끼리는 겹칠 수 있어서 -1. 파이프도 -1. */
+int sys_copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+	struct file *in, *out;
+	uint8_t *kbuf;
+	unsigned total = 0;
+
+	if (!fd_for_read(in_fd, &in) || in == NULL || !fd_for_write(out_fd, &out))
+		return -1;
+	if (file_is_pipe(in) || (out != NULL && file_is_pipe(out)))
+		return -1;
+	if (out != NULL && file_get_inode(in) == file_get_inode(out))
+		return -1;
+	if (length > INT_MAX)
+		length = INT_MAX;
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+
+	/* filesys_lock 은 read_to_user 처럼 조각마다 잡았다 놓아서 긴 복사가
+	 * 다른 프로세스의 파일 접근을 오래 막지 않게 한다. */
+	while (total < length)
 	{
-	case STDIN_FILENO:
-		size = -1;
-		break;
-		
-	case STDOUT_FILENO:
+		unsigned chunk = length - total < PGSIZE ? length - total : PGSIZE;
+		off_t n, written;
+
 		lock_acquire_if_available(&filesys_lock);
-		putbuf(buffer, size);
+		n = file_read(in, kbuf, chunk);
+		if (n <= 0)
+		{
+			lock_release_if_available(&filesys_lock);
+			break;
+		}
+		if (out == NULL)	// 표준 출력
+		{
+			putbuf((const char *) kbuf, n);
+			written = n;
+		}
+		else
+			written = file_write(out, kbuf, n);
+		/* 다 못 썼으면 못 쓴 만큼 읽은 위치를 되돌린다. */
+		if (written < n)
+			file_seek(in, file_tell(in) - (n - written));
 		lock_release_if_available(&filesys_lock);
-		break;
+		total += written;
+		if ((unsigned) written < chunk)
+			break;
+	}
+	return total;
+}
 
+/* 링 요청 SQE 하나를 처리하고 그 시스템 콜의 반환값을 돌려준다.
+ * 따로 부른 시스템 콜과 달리 잘못된 fd 나 버퍼는 프로세스를 끝내지
+ * 않고 -1 로 완료된다. */
+static int ring_do_op (const struct io_sqe *sqe, uint8_t *kbuf)
+{
+	struct file *file;
+	off_t off = sqe->off;
+	char name[NAME_MAX + 1];
+	long len;
+
+	switch (sqe->opcode)
+	{
+	case IORING_OP_NOP:
+		return 0;
+	case IORING_OP_READ:
+		if (sqe->fd < 0 || !fd_for_read(sqe->fd, &file)
+				|| (off >= 0 && (file == NULL || file_is_pipe(file))))
+			return -1;
+		return read_to_user(file, (void *) sqe->addr, sqe->len,
+				off >= 0 ? &off : NULL, kbuf);
+	case IORING_OP_WRITE:
+		if (sqe->fd < 0 || !fd_for_write(sqe->fd, &file)
+				|| (off >= 0 && (file == NULL || file_is_pipe(file))))
+			return -1;
+		return write_from_user(file, (const void *) sqe->addr, sqe->len,
+				off >= 0 ? &off : NULL, kbuf);
+	case IORING_OP_OPEN:
+		len = strncpy_from_user(name, (const char *) sqe->addr, sizeof name);
+		if (len < 0 || len > NAME_MAX)
+			return -1;
+		return open_name(name);
+	case IORING_OP_CLOSE:
+		if (get_file_from_fd(sqe->fd) == NULL)
+			return -1;
+		sys_close(sqe->fd);
+		return 0;
 	default:
-        {
-			lock_acquire_if_available(&filesys_lock);
-            struct file *f = get_file_from_fd(fd);
-            if (f == NULL) {
-                // lock_release(&filesys_lock);
-                return -1;
-            }
-            size = file_write(f, buffer, size);
-			lock_release_if_available(&filesys_lock);
-        }
-        break;
-	}
-	return size;
-
-	// if(fd == STDIN_FILENO) {//0이면 표준 입력이니 -1 오류 리턴
-	// 	// lock_release(&filesys_lock);
-	// 	return -1; 
-	// }
-	// else if (fd == STDOUT_FILENO) //1이면 표준출력
-	// {
-	// 	lock_acquire(&filesys_lock);
-	// 	putbuf(buffer, size);
-	// 	lock_release(&filesys_lock);
-	// 	return size;
-	// }
-	// else
-	// {
-	// 	struct file *f = get_file_from_fd(fd);
-	// 	if(f == NULL) {
-	// 		// lock_release(&filesys_lock);
-	// 		return -1;
-	// 	}
-	// 	lock_acquire(&filesys_lock);
-	// 	int write_byte = file_write(f, buffer, size);
-	// 	lock_release(&filesys_lock);
-	// 	return write_byte;
-	// }
-	// // lock_release(&filesys_lock);
-	// return -1;
+		return -1;
+	}
+}
+
+/* 이 프로세스의 링을 RING 으로 등록한다. NULL 이면 등록을 푼다.
+ * 링은 유저 메모리에 있고 ring_enter 때마다 uaccess 로 읽고 쓴다. */
+int sys_ring_setup (struct io_ring *ring)
+{
+	if (ring != NULL && (!uaccess_ok(ring, sizeof *ring)
+				|| (uintptr_t) ring % sizeof (uint64_t) != 0))
+		return -1;
+	thread_current()->io_ring = ring;
+	return 0;
+}
+
+/* 링의 제출 큐에서 TO_SUBMIT 개까지 요청을 꺼내 처리하고 결과를 완료
+ * 큐에 올린다. 완료 큐가 차면 거기서 멈춘다. 트랩 한 번으로 여러
+ * 요청을 처리하고, 데이터용 커널 페이지도 하나를 같이 쓴다.
+ * 처리한 요청 수를 돌려준다. */
+int sys_ring_enter (unsigned to_submit)
+{
+	struct io_ring *ring = thread_current()->io_ring;
+	uint32_t idx[4];			// sq_head, sq_tail, cq_head, cq_tail
+	struct io_sqe sqe;
+	struct io_cqe cqe;
+	uint8_t *kbuf;
+	unsigned done = 0;
+
+	if (ring == NULL)
+		return -1;
+	if (!copy_from_user(idx, ring, sizeof idx))
+		sys_exit(-1);
+	if (idx[1] - idx[0] > IORING_ENTRIES || idx[3] - idx[2] > IORING_ENTRIES)
+		return -1;			// 유저가 망가뜨린 링
+	if ((kbuf = bounce_page()) == NULL)
+		return -1;
+
+	while (done < to_submit && idx[0] != idx[1]
+			&& idx[3] - idx[2] < IORING_ENTRIES)
+	{
+		if (!copy_from_user(&sqe, &ring->sq[idx[0] % IORING_ENTRIES], sizeof sqe))
+			goto fault;
+		cqe.user_data = sqe.user_data;
+		cqe.res = ring_do_op(&sqe, kbuf);
+		cqe.pad = 0;
+		if (!copy_to_user(&ring->cq[idx[3] % IORING_ENTRIES], &cqe, sizeof cqe))
+			goto fault;
+		idx[0]++;
+		idx[3]++;
+		done++;
+	}
+
+	if (!copy_to_user(&ring->sq_head, &idx[0], sizeof idx[0])
+			|| !copy_to_user(&ring->cq_tail, &idx[3], sizeof idx[3]))
+		goto fault;
+	return done;
+
+fault:
+	sys_exit(-1);
+	NOT_REACHED();
 }
 
 /* seek 시스템 콜은 파일의 현재 읽기/쓰기 위치를 
@@ -376,12 +947,11 @@ unsigned sys_tell (int fd)
 /* file 닫기 */
 void sys_close(int fd)
 {
-	struct file *f = get_file_from_fd(fd);
+	struct file *f = remove_fd(fd);
 	if(f != NULL)
 	{
 		lock_acquire(&filesys_lock);
 		file_close(f);
-		remove_fd(fd);
 		lock_release(&filesys_lock);
 	}
 }
@@ -396,9 +966,16 @@ void sys_halt(void)
 void sys_exit(int status)
 {
 	struct thread *t = thread_current();
+	#ifdef USERPROG 
+	/* 어느 스레드가 죽든 프로세스 전체가 끝난다. 먼저 끝내기 시작한
+	 * 쪽의 status 를 쓰고, 끝났다는 줄은 주인만 찍는다. */
+	process_group_exit(t->proc, status);
+	status = t->proc->group_status;
+	#endif
 	t->exit_status = status;
 	#ifdef USERPROG 
-	printf("%s: exit(%d)\n", t->name, t->exit_status);
+	if (t->proc == t)
+		printf("%s: exit(%d)\n", t->name, t->exit_status);
 	#endif
 	thread_exit();
 }
@@ -408,11 +985,12 @@ void sys_exit(int status)
 해당 오픈 파일은 close 되지 않고 그대로 켜진 상태로 남아있는다.*/
 bool sys_remove (const char *file) 
 {
-	check_address(file);
-	if(!file_is_valid(file))
-		sys_exit(-1);
+	char name[NAME_MAX + 1];
+
+	if(!copy_in_name(name, file))
+		return false;
 	lock_acquire_if_available(&filesys_lock);
-	bool result = filesys_remove(file);
+	bool result = filesys_remove(name);
 	lock_release_if_available(&filesys_lock);
     return result;
 }
@@ -420,12 +998,27 @@ bool sys_remove (const char *file)
 
 pid_t fork (const char *thread_name)
 {
+	/* 주소 공간의 주인만 fork 할 수 있다. */
+	if (thread_current()->proc != thread_current())
+		return TID_ERROR;
 	return process_fork(thread_name, thread_current()->pre_if);
 }
 
 int sys_exec (const char *cmd_line) {
-	char *temp = palloc_get_page(PAL_ZERO);
-	strlcpy(temp, cmd_line, strlen(cmd_line) + 1);
+	struct thread *cur = thread_current();
+
+	/* 다른 스레드가 같이 쓰는 주소 공간은 바꿀 수 없다. */
+	if (cur->proc != cur || !list_empty(&cur->clone_list))
+		return -1;
+	char *temp = palloc_get_page(0);
+	if (temp == NULL)
+		return -1;
+	/* 유저 문자열은 uaccess 로 복사한다. 페이지를 넘으면 실패 */
+	long len = strncpy_from_user(temp, cmd_line, PGSIZE);
+	if (len < 0 || len == PGSIZE) {
+		palloc_free_page(temp);
+		sys_exit(-1);
+	}
 	// if (!lock_held_by_current_thread(&filesys_lock))
 		// lock_acquire(&filesys_lock);
 	int result = -1;
@@ -445,6 +1038,33 @@ int wait(pid_t tid)
 	return process_wait (tid);
 }
 
+#ifdef VM
+/* fd 로 연 파일을 ADDR 에 매핑. 잘못된 인자면 NULL 을 돌려준다. */
+void *sys_mmap (void *addr, size_t length, int writable, int fd, off_t offset)
+{
+	struct file *file;
+
+	if (addr == NULL || pg_ofs(addr) != 0 || offset % PGSIZE != 0)
+		return NULL;
+	if ((long long) length <= 0 || offset < 0)
+		return NULL;
+	if (!is_user_vaddr(addr) || !is_user_vaddr((uint8_t *) addr + length - 1)
+			|| (uintptr_t) addr + length < (uintptr_t) addr)
+		return NULL;
+	if ((file = get_file_from_fd(fd)) == NULL)
+		return NULL;
+	if (file_length(file) == 0)
+		return NULL;
+	return do_mmap(addr, length, writable, file, offset);
+}
+
+/* mmap 으로 만든 매핑 해제 */
+void sys_munmap (void *addr)
+{
+	do_munmap(addr);
+}
+#endif
+
 
 
 
@@ -455,43 +1075,263 @@ int wait(pid_t tid)
 
 /* fd에 해당하는 파일 추가 삭제 들고오기 */
 
+/* fd 테이블은 FD_INLINE 칸짜리 struct thread 안의 배열로 시작해서
+ * 꽉 차면 두 배씩 힙으로 늘린다. 쓰는 칸은 fd_map 비트맵에 표시하고,
+ * 새 fd 는 비트맵 워드에서 처음 0 인 비트를 찾아 가장 작은 빈 번호를
+ * 준다. 워드 하나가 64 칸이라 수천 개를 열어도 몇 워드만 본다. */
+#define FD_MAP_BITS 64
+#define FD_MAP_WORDS(cap) (((cap) + FD_MAP_BITS - 1) / FD_MAP_BITS)
+
+/* fd 테이블은 clone 한 스레드들이 같이 쓰므로 proc 의 것을 fd_lock 을
+ * 잡고 본다. 돌려준 파일을 다른 스레드가 쓰는 도중에 닫는 것은 막지
+ * 않는다. */
+
 //fd배열에서 file 가져오기
 struct file *get_file_from_fd (int fd)
 {
-	struct thread *t = thread_current();
-	if(fd < 2 || fd > INT8_MAX)
-		return NULL;
-	return t->fd_table[fd];
+	struct thread *t = thread_current()->proc;
+	struct file *file = NULL;
+
+	lock_acquire(&t->fd_lock);
+	if(fd >= 0 && (unsigned) fd < t->fd_cap)
+		file = t->fd_table[fd];
+	lock_release(&t->fd_lock);
+	return file;
+}
+
+/* T 의 fd 테이블을 CAP 칸으로 늘린다. 메모리가 없으면 false. */
+static bool fd_table_grow (struct thread *t, unsigned cap)
+{
+	struct file **table = calloc(cap, sizeof *table);
+	uint64_t *map = calloc(FD_MAP_WORDS(cap), sizeof *map);
+
+	if (table == NULL || map == NULL)
+	{
+		free(table);
+		free(map);
+		return false;
+	}
+	memcpy(table, t->fd_table, t->fd_cap * sizeof *table);
+	memcpy(map, t->fd_map, FD_MAP_WORDS(t->fd_cap) * sizeof *map);
+	if (t->fd_table != t->fd_inline)
+	{
+		free(t->fd_table);
+		free(t->fd_map);
+	}
+	t->fd_table = table;
+	t->fd_map = map;
+	t->fd_cap = cap;
+	return true;
 }
 
 /* 해당 파일을 파일 디스크립터 배열에 추가 */
+/* 비어 있는 가장 작은 fd 를 준다. 다 찼으면 테이블을 늘린다. */
 int add_file_to_fd_table (struct file *file)
 {
-	struct thread *t = thread_current();
-    for (int i = t->fd; i < INT8_MAX; i++) {
-        if (t->fd_table[i] == NULL) {
-            t->fd_table[i] = file;
-			t->fd = i;
-            return i;
-        }
-    }
-	t->fd = INT8_MAX;
-    return -1;
+	struct thread *t = thread_current()->proc;
+	unsigned words, fd;
+
+	lock_acquire(&t->fd_lock);
+	words = FD_MAP_WORDS(t->fd_cap);
+	fd = t->fd_cap;
+	for (unsigned w = 0; w < words; w++)
+		if (~t->fd_map[w] != 0)
+		{
+			fd = w * FD_MAP_BITS + __builtin_ctzll(~t->fd_map[w]);
+			break;
+		}
+	if (fd >= t->fd_cap)
+	{
+		/* fd_cap 이 워드 경계가 아니면 마지막 워드의 빈 비트가 테이블 밖이다. */
+		fd = t->fd_cap;
+		if (fd >= INT_MAX / 2 || !fd_table_grow(t, t->fd_cap * 2))
+		{
+			lock_release(&t->fd_lock);
+			return -1;
+		}
+	}
+
+	t->fd_map[fd / FD_MAP_BITS] |= (uint64_t) 1 << (fd % FD_MAP_BITS);
+	t->fd_table[fd] = file;
+	lock_release(&t->fd_lock);
+	return fd;
 }
 
 /* fd에 해당하는 파일 제거 */
-void remove_fd(int fd) 
+/* 0, 1 은 콘솔로 돌아갈 뿐 새 파일에 주지 않으므로 비트를 남긴다.
+ * 떼어 낸 파일을 돌려주고, 닫는 것은 부른 쪽이 한다. */
+struct file *remove_fd(int fd) 
 {
-	struct thread *t = thread_current();
-	if(fd > 1 && fd < INT8_MAX)
-		return t->fd_table[fd] = NULL;
+	struct thread *t = thread_current()->proc;
+	struct file *file = NULL;
+
+	lock_acquire(&t->fd_lock);
+	if(fd >= 0 && (unsigned) fd < t->fd_cap)
+	{
+		file = t->fd_table[fd];
+		t->fd_table[fd] = NULL;
+		if (fd > 1)
+			t->fd_map[fd / FD_MAP_BITS] &= ~((uint64_t) 1 << (fd % FD_MAP_BITS));
+	}
+	lock_release(&t->fd_lock);
+	return file;
+}
+
+/* 파이프를 만들어 읽기 끝, 쓰기 끝 fd 를 유저 배열 FDS 에 넣는다. */
+int sys_pipe (int *fds)
+{
+	struct pipe *p;
+	struct file *rf, *wf;
+	int kfds[2];
+
+	if (!uaccess_ok(fds, sizeof kfds))
+		sys_exit(-1);
+	if ((p = pipe_create()) == NULL)
+		return -1;
+	rf = file_open_pipe(p, false);
+	wf = file_open_pipe(p, true);
+	if (rf == NULL || wf == NULL)
+	{
+		file_close(rf);
+		file_close(wf);
+		return -1;
+	}
+	if ((kfds[0] = add_file_to_fd_table(rf)) < 0)
+	{
+		file_close(rf);
+		file_close(wf);
+		return -1;
+	}
+	if ((kfds[1] = add_file_to_fd_table(wf)) < 0)
+	{
+		sys_close(kfds[0]);
+		file_close(wf);
+		return -1;
+	}
+	/* 실패하면 두 fd 는 프로세스가 끝날 때 닫힌다. */
+	if (!copy_to_user(fds, kfds, sizeof kfds))
+		sys_exit(-1);
+	return 0;
+}
+
+/* NEWFD 도 OLDFD 의 파일을 가리키게 한다. NEWFD 가 열려 있었으면 먼저
+ * 닫고, 두 fd 는 파일 위치까지 같이 쓴다. 파이프 끝을 0, 1 에 붙여
+ * 표준 입출력을 바꿀 수 있다. 콘솔은 파일이 아니라서 OLDFD 로 줄 수
+ * 없다. */
+int sys_dup2 (int oldfd, int newfd)
+{
+	struct thread *t = thread_current()->proc;
+	struct file *file, *old = NULL;
+	unsigned cap;
+
+	if (newfd < 0)
+		return -1;
+	lock_acquire(&t->fd_lock);
+	file = oldfd >= 0 && (unsigned) oldfd < t->fd_cap ? t->fd_table[oldfd] : NULL;
+	if (file == NULL || oldfd == newfd)
+	{
+		lock_release(&t->fd_lock);
+		return file == NULL ? -1 : newfd;
+	}
+	for (cap = t->fd_cap; cap <= (unsigned) newfd; cap *= 2)
+		if (cap > INT_MAX / 2)
+			break;
+	if (cap <= (unsigned) newfd || (cap != t->fd_cap && !fd_table_grow(t, cap)))
+	{
+		lock_release(&t->fd_lock);
+		return -1;
+	}
+
+	/* 원래 있던 파일은 테이블에서 바꿔 끼운 뒤 락 밖에서 닫는다. */
+	old = t->fd_table[newfd];
+	t->fd_table[newfd] = file_dup(file);
+	t->fd_map[newfd / FD_MAP_BITS] |= (uint64_t) 1 << (newfd % FD_MAP_BITS);
+	lock_release(&t->fd_lock);
+
+	if (old != NULL)
+	{
+		lock_acquire(&filesys_lock);
+		file_close(old);
+		lock_release(&filesys_lock);
+	}
+	return newfd;
+}
+
+/* fork 할 때 SRC 의 열린 파일들을 DST 로 복제한다. */
+bool fd_table_copy (struct thread *dst, struct thread *src)
+{
+	bool ok = true;
+
+	lock_acquire(&src->fd_lock);
+	if (src->fd_cap > dst->fd_cap && !fd_table_grow(dst, src->fd_cap))
+		ok = false;
+	for (unsigned i = 0; ok && i < src->fd_cap; i++)
+	{
+		unsigned j;
+
+		if (src->fd_table[i] == NULL)
+			continue;
+		/* dup2 로 같은 파일을 가리키던 fd 는 자식에서도 복제본 하나를 같이 쓴다. */
+		for (j = 0; j < i; j++)
+			if (src->fd_table[j] == src->fd_table[i])
+				break;
+		if (j < i)
+			dst->fd_table[i] = file_dup(dst->fd_table[j]);
+		else
+			dst->fd_table[i] = file_duplicate(src->fd_table[i]);
+		if (dst->fd_table[i] == NULL)
+			ok = false;
+	}
+	if (ok)
+		memcpy(dst->fd_map, src->fd_map, FD_MAP_WORDS(src->fd_cap) * sizeof *dst->fd_map);
+	lock_release(&src->fd_lock);
+	return ok;
+}
+
+/* T 의 fd 테이블에 있는 파이프에서 자는 스레드를 모두 깨운다.
+ * 프로세스가 끝날 때 같은 테이블의 파이프에서 자던 clone 이 끝날 수 있게 한다. */
+void fd_table_wake_pipes (struct thread *t)
+{
+	lock_acquire(&t->fd_lock);
+	for (unsigned i = 0; i < t->fd_cap; i++)
+	{
+		struct file *file = t->fd_table[i];
+		struct pipe *p;
+
+		if (file == NULL || !file_is_pipe(file))
+			continue;
+		p = file_get_pipe(file, false);
+		if (p == NULL)
+			p = file_get_pipe(file, true);
+		pipe_wake(p);
+	}
+	lock_release(&t->fd_lock);
+}
+
+/* T 의 열린 파일을 모두 닫고 힙으로 옮긴 테이블을 푼다. */
+void fd_table_destroy (struct thread *t)
+{
+	for (unsigned i = 0; i < t->fd_cap; i++)
+		if (t->fd_table[i] != NULL)
+		{
+			file_close(t->fd_table[i]);
+			t->fd_table[i] = NULL;
+		}
+	if (t->fd_table != t->fd_inline)
+	{
+		free(t->fd_table);
+		free(t->fd_map);
+		t->fd_table = t->fd_inline;
+		t->fd_map = &t->fd_inline_map;
+		t->fd_cap = FD_INLINE;
+	}
+	t->fd_inline_map = 0x3;
 }
 
 /* fd가 유효한지 확인 */
 bool fd_is_valid(int fd)
 {
-	if(-1 < fd && fd < INT8_MAX) return true;
-	else return false;
+	return fd >= 0;
 }
 
 /* 파일이 유효한지 확인 */
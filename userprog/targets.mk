@@ -2,5 +2,9 @@ userprog_SRC  = userprog/process.c	# Process loading.
 userprog_SRC += userprog/exception.c	# User exception handler.
 userprog_SRC += userprog/syscall-entry.S # System call entry.
 userprog_SRC += userprog/syscall.c	# System call handler.
+userprog_SRC += userprog/uaccess.c	# User memory access.
+userprog_SRC += userprog/uaccess-copy.S # User memory copy with fault fixup.
+userprog_SRC += userprog/trace.c	# System call tracer.
+userprog_SRC += userprog/futex.c	# User-space lock wait queues.
 userprog_SRC += userprog/gdt.c		# GDT initialization.
 userprog_SRC += userprog/tss.c		# TSS management.
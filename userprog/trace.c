@@ -0,0 +1,95 @@
+#include "userprog/trace.h"
+#include "threads/synch.h"
+#include "userprog/uaccess.h"
+
+/* 시스템 콜 trace 버퍼.
+
+   trace 가 켜진 프로세스의 시스템 콜은 돌아올 때마다 커널 전체에
+   하나인 링 버퍼에 기록을 남긴다. 쓰는 쪽은 head 를 원자적으로
+   올려 칸을 잡고 내용을 채운 뒤 seq 를 써서 공개한다. 락도
+   인터럽트 끄기도 없으므로 쓰는 도중 다른 스레드로 넘어가도 된다.
+   버퍼가 차면 오래된 기록부터 덮어쓴다.
+
+   읽는 쪽은 seqlock 처럼 복사 앞뒤로 seq 를 보고, 그사이 덮어쓰인
+   기록은 건너뛰고 아직 쓰는 중인 기록에서 멈춘다. 읽는 위치는
+   하나라서 읽는 쪽끼리는 락으로 줄을 세운다.
+
+   trace 가 꺼져 있으면 syscall_handler() 에서 플래그 하나만 본다. */
+
+#define TRACE_ENTRIES 256           /* 2의 거듭제곱 */
+
+static struct trace_rec ring[TRACE_ENTRIES];
+static uint64_t head;               /* 다음에 잡을 번호 */
+static uint64_t tail;               /* 다음에 읽을 번호 */
+static struct lock read_lock;
+
+void
+trace_init (void) {
+	lock_init (&read_lock);
+}
+
+/* TID 의 시스템 콜 NR 이 F 의 인자로 RET 를 돌려주고 CYCLES 만큼
+ * 걸렸다고 기록한다. */
+void
+trace_log (int tid, unsigned nr, const struct intr_frame *f,
+		uint64_t ret, uint64_t cycles) {
+	uint64_t seq = __atomic_fetch_add (&head, 1, __ATOMIC_RELAXED);
+	struct trace_rec *r = &ring[seq % TRACE_ENTRIES];
+
+	__atomic_store_n (&r->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+	r->tid = tid;
+	r->nr = nr;
+	r->args[0] = f->R.rdi;
+	r->args[1] = f->R.rsi;
+	r->args[2] = f->R.rdx;
+	r->args[3] = f->R.r10;
+	r->args[4] = f->R.r8;
+	r->ret = ret;
+	r->cycles = cycles;
+	__atomic_store_n (&r->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/* 아직 읽지 않은 기록을 CNT 개까지 유저 버퍼 UBUF 에 옮긴다.
+ * 옮긴 수를 돌려주고, UBUF 가 잘못됐으면 -1. */
+int
+trace_read (struct trace_rec *ubuf, unsigned cnt) {
+	struct trace_rec rec;
+	unsigned n = 0;
+
+	lock_acquire (&read_lock);
+	while (n < cnt) {
+		uint64_t h = __atomic_load_n (&head, __ATOMIC_ACQUIRE);
+		struct trace_rec *r;
+		uint64_t s1, s2;
+
+		if (h - tail > TRACE_ENTRIES)
+			tail = h - TRACE_ENTRIES;       /* 덮어쓰인 기록은 버린다 */
+		if (tail == h)
+			break;
+		r = &ring[tail % TRACE_ENTRIES];
+
+		s1 = __atomic_load_n (&r->seq, __ATOMIC_ACQUIRE);
+		rec = *r;
+		__atomic_thread_fence (__ATOMIC_ACQUIRE);
+		s2 = __atomic_load_n (&r->seq, __ATOMIC_RELAXED);
+		if (s1 != tail + 1 || s2 != tail + 1) {
+			/* 복사하는 사이 덮어쓰였으면 건너뛰고, 아직 쓰는 중이면
+			 * 다음 번에 읽는다. */
+			if (__atomic_load_n (&head, __ATOMIC_ACQUIRE) - tail
+					> TRACE_ENTRIES) {
+				tail++;
+				continue;
+			}
+			break;
+		}
+		if (!copy_to_user (&ubuf[n], &rec, sizeof rec)) {
+			lock_release (&read_lock);
+			return -1;
+		}
+		tail++;
+		n++;
+	}
+	lock_release (&read_lock);
+	return n;
+}
@@ -0,0 +1,85 @@
+#include "userprog/uaccess.h"
+#include "threads/vaddr.h"
+
+/* 유저 메모리 복사.
+
+   예전에는 시스템 콜마다 check_address() 로 버퍼 첫 바이트만
+   pml4_get_page 로 확인하고 나머지는 그냥 건드렸다. 여기서는 범위가
+   유저 영역 안인지만 산술로 확인하고 곧바로 복사한다. 매핑되지 않은
+   페이지는 복사 도중 폴트가 나고, VM 이 처리하지 못하면 page_fault()
+   가 search_exception_table() 로 복구 코드를 찾아 복사를 실패로
+   돌려보낸다. 페이지 테이블을 미리 걷지 않는다. */
+
+/* 어셈블리 쪽 (uaccess-copy.S) */
+struct exception_entry {
+	uintptr_t insn;             /* 폴트가 날 수 있는 명령 */
+	uintptr_t fixup;            /* 폴트가 나면 이어서 실행할 곳 */
+};
+extern const struct exception_entry uaccess_ex_table[], uaccess_ex_table_end[];
+
+size_t __copy_user (void *dst, const void *src, size_t size);
+long __strncpy_user (char *dst, const char *src, size_t size);
+int __touch_user_write (uint32_t *uaddr);
+
+/* [UADDR, UADDR + SIZE) 가 모두 유저 영역이면 true. 매핑 여부는 보지 않는다. */
+bool
+uaccess_ok (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+
+	if (size == 0)
+		return true;
+	return start + size > start && start + size <= KERN_BASE;
+}
+
+/* 유저 주소 USRC 에서 SIZE 바이트를 DST 로 복사한다. 실패하면 false. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	return uaccess_ok (usrc, size) && __copy_user (dst, usrc, size) == 0;
+}
+
+/* SRC 에서 SIZE 바이트를 유저 주소 UDST 로 복사한다. 실패하면 false.
+   읽기 전용 유저 페이지에 쓰면 (CR0.WP) 폴트가 나서 실패한다. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	return uaccess_ok (udst, size) && __copy_user (udst, src, size) == 0;
+}
+
+/* 유저 문자열 USRC 를 NUL 까지 최대 SIZE 바이트 DST 로 복사하고
+   NUL 을 뺀 길이를 돌려준다. SIZE 안에 NUL 이 없으면 SIZE (DST 는
+   NUL 로 끝나지 않는다). 잘못된 주소면 -1. */
+long
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	uintptr_t start = (uintptr_t) usrc;
+	size_t limit = size;
+	long len;
+
+	if (start >= KERN_BASE)
+		return -1;
+	if (limit > KERN_BASE - start)
+		limit = KERN_BASE - start;
+	len = __strncpy_user (dst, usrc, limit);
+	/* 유저 영역 끝까지 NUL 이 없었다. */
+	if (len >= 0 && (size_t) len == limit && limit < size)
+		return -1;
+	return len;
+}
+
+/* 4 바이트 정렬된 유저 단어 UADDR 를 값은 그대로 둔 채 원자적으로
+   써서, 쓸 수 있는 자기 프레임에 올라와 있게 한다. 쓸 수 없는
+   주소면 false. */
+bool
+touch_user_write (uint32_t *uaddr) {
+	return (uintptr_t) uaddr % sizeof *uaddr == 0
+		&& uaccess_ok (uaddr, sizeof *uaddr) && __touch_user_write (uaddr) == 0;
+}
+
+/* 커널에서 RIP 에서 난 폴트를 복구할 곳. 없으면 0. */
+uintptr_t
+search_exception_table (uintptr_t rip) {
+	const struct exception_entry *e;
+
+	for (e = uaccess_ex_table; e < uaccess_ex_table_end; e++)
+		if (e->insn == rip)
+			return e->fixup;
+	return 0;
+}
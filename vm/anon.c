@@ -1,7 +1,16 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
+#include <string.h>
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* 한 페이지를 담는 데 필요한 섹터 수 */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -9,6 +18,15 @@ static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
 
+/* 스왑 슬롯 사용 여부. 슬롯 하나가 한 페이지(SECTORS_PER_PAGE 섹터). */
+static struct bitmap *swap_table;
+static struct lock swap_lock;
+
+/* 0 으로 채워진 프레임 하나. 아직 쓴 적 없는 anon 페이지를 읽기만 하면
+ * 모두 이 프레임을 읽기 전용으로 매핑하고, 처음 쓸 때 따로 받는다.
+ * frame_table 에 넣지 않으므로 쫓겨나거나 해제되지 않는다. */
+static void *zero_kva;
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -21,7 +39,12 @@ static const struct page_operations anon_ops = {
 void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	swap_table = bitmap_create (swap_disk != NULL
+			? disk_size (swap_disk) / SECTORS_PER_PAGE : 0);
+	lock_init (&swap_lock);
+	zero_kva = palloc_get_page (PAL_USER | PAL_ZERO);
+	ASSERT (zero_kva != NULL);
 }
 
 /* Initialize the file mapping */
@@ -31,22 +54,86 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = BITMAP_ERROR;
+	anon_page->zero_mapped = false;
+	/* init 없는 페이지는 vm_do_claim_page 가 0 으로 채운 프레임을 주고,
+	 * 파일에서 읽는 페이지는 lazy_load_segment 가 한 페이지를 다 채운다. */
+	return true;
+}
+
+/* 아직 초기화 안 된 anon PAGE 에 zero 프레임을 읽기 전용으로 매핑한다.
+ * 프레임 없이 anon 페이지로 바꿔 두고, 쓰기 폴트가 나면 swap_in 에서
+ * 새 프레임을 0 으로 채운다. */
+bool
+anon_map_zero (struct page *page) {
+	ASSERT (page->frame == NULL);
+
+	if (!pml4_set_page (page->pml4, page->va, zero_kva, false))
+		return false;
+	page->operations = &anon_ops;
+	page->anon.swap_slot = BITMAP_ERROR;
+	page->anon.zero_mapped = true;
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot = anon_page->swap_slot;
+
+	/* 프레임은 vm_do_claim_page 에서 이미 0 으로 받아 왔다. */
+	if (anon_page->zero_mapped) {
+		anon_page->zero_mapped = false;
+		return true;
+	}
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	for (int i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_read (swap_disk, slot * SECTORS_PER_PAGE + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_table, slot);
+	lock_release (&swap_lock);
+	anon_page->swap_slot = BITMAP_ERROR;
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot;
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	lock_release (&swap_lock);
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	for (int i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_write (swap_disk, slot * SECTORS_PER_PAGE + i,
+				(uint8_t *) page->frame->kva + i * DISK_SECTOR_SIZE);
+	anon_page->swap_slot = slot;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* 쫓겨나는 중이면 스왑 슬롯이 정해질 때까지 기다리고 프레임을 고정한다. */
+	vm_hold_frame (page);
+	if (anon_page->swap_slot != BITMAP_ERROR) {
+		lock_acquire (&swap_lock);
+		bitmap_reset (swap_table, anon_page->swap_slot);
+		lock_release (&swap_lock);
+	}
+	/* zero 프레임은 공유 중이라 매핑만 끊는다. */
+	if (anon_page->zero_mapped)
+		pml4_clear_page (page->pml4, page->va);
+	vm_free_frame (page);
 }
@@ -1,8 +1,19 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <hash.h>
+#include <round.h>
+#include <string.h>
 #include "vm/vm.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
+static void file_backed_publish (struct page *page);
+static void unmap_pages (struct supplemental_page_table *spt, void *addr);
 static bool file_backed_swap_out (struct page *page);
 static void file_backed_destroy (struct page *page);
 
@@ -14,45 +25,340 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* 메모리에 올라와 있는 파일 페이지 하나.
+ * 같은 inode 의 같은 위치를 매핑한 페이지들은 프로세스가 달라도
+ * 이 프레임 하나를 같이 쓴다. */
+struct file_share {
+	struct inode *inode;
+	off_t ofs;
+	struct frame *frame;
+	struct list pages;            /* 이 프레임을 매핑한 file 페이지들 */
+	struct hash_elem hash_elem;
+};
+
+/* (inode, ofs) -> file_share. share_lock 을 잡은 채 vm_detach_frame() 으로
+ * frame_lock 을 잡을 수 있고, 반대 순서로는 잡지 않는다. */
+static struct hash share_table;
+static struct lock share_lock;
+
+static uint64_t
+share_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct file_share *s = hash_entry (e, struct file_share, hash_elem);
+	return hash_bytes (&s->inode, sizeof s->inode) ^ hash_int (s->ofs);
+}
+
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct file_share *a = hash_entry (a_, struct file_share, hash_elem);
+	const struct file_share *b = hash_entry (b_, struct file_share, hash_elem);
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->ofs < b->ofs;
+}
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	hash_init (&share_table, share_hash, share_less, NULL);
+	lock_init (&share_lock);
+}
+
+/* 시스템 콜 도중(filesys_lock 을 잡은 채) 폴트가 날 수도 있어서
+ * 이미 잡고 있으면 다시 잡지 않는다. 잡았으면 true. */
+static bool
+filesys_lock_acquire (void) {
+	if (lock_held_by_current_thread (&filesys_lock))
+		return false;
+	lock_acquire (&filesys_lock);
+	return true;
+}
+
+/* uninit 페이지의 aux 에서 file_page 를 채운다.
+ * page->file 이 page->uninit 과 겹치므로 aux 를 먼저 꺼낸다. */
+static void
+file_page_setup (struct page *page) {
+	struct lazy_load_info *info = page->uninit.aux;
+	struct file_page *file_page = &page->file;
+
+	ASSERT (!info->prefilled);
+	page->operations = &file_ops;
+	*file_page = (struct file_page) {
+		.file = info->file,
+		.ofs = info->ofs,
+		.read_bytes = info->read_bytes,
+		.zero_bytes = info->zero_bytes,
+		.map_addr = info->map_addr,
+		.share = NULL,
+	};
+	free (info);
 }
 
 /* Initialize the file backed page */
 bool
 file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	/* Set up the handler */
-	page->operations = &file_ops;
+	struct lazy_load_info *info = page->uninit.aux;
 
-	struct file_page *file_page = &page->file;
+	/* fault-around 가 이미 읽어 두었으면 나머지만 0 으로 채운다. */
+	if (info->prefilled) {
+		info->prefilled = false;
+		file_page_setup (page);
+		memset ((uint8_t *) kva + page->file.read_bytes, 0, page->file.zero_bytes);
+		file_backed_publish (page);
+		return true;
+	}
+	file_page_setup (page);
+	return file_backed_swap_in (page, kva);
+}
+
+/* PAGE 와 같은 파일 위치가 이미 다른 곳에 올라와 있으면
+ * 그 프레임을 같이 매핑한다. 공유했으면 true. */
+bool
+file_backed_share (struct page *page) {
+	struct file_share key, *share;
+	struct hash_elem *e;
+	bool uninit = VM_TYPE (page->operations->type) == VM_UNINIT;
+
+	ASSERT (page->frame == NULL);
+
+	if (uninit) {
+		struct lazy_load_info *info = page->uninit.aux;
+		key.inode = file_get_inode (info->file);
+		key.ofs = info->ofs;
+	} else {
+		key.inode = file_get_inode (page->file.file);
+		key.ofs = page->file.ofs;
+	}
+
+	lock_acquire (&share_lock);
+	e = hash_find (&share_table, &key.hash_elem);
+	if (e == NULL) {
+		lock_release (&share_lock);
+		return false;
+	}
+	share = hash_entry (e, struct file_share, hash_elem);
+	if (!pml4_set_page (page->pml4, page->va, share->frame->kva,
+				page->writable)) {
+		lock_release (&share_lock);
+		return false;
+	}
+	if (uninit)
+		file_page_setup (page);
+	page->frame = share->frame;
+	page->file.share = share;
+	list_push_back (&share->pages, &page->file.share_elem);
+	lock_release (&share_lock);
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page UNUSED = &page->file;
+	bool locked;
+	off_t read;
+
+	locked = filesys_lock_acquire ();
+	read = file_read_at (file_page->file, kva, file_page->read_bytes,
+			file_page->ofs);
+	if (locked)
+		lock_release (&filesys_lock);
+	if (read != (off_t) file_page->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + file_page->read_bytes, 0, file_page->zero_bytes);
+	file_backed_publish (page);
+	return true;
+}
+
+/* 다른 프로세스가 같은 위치를 매핑하면 PAGE 의 프레임을 쓰도록 등록한다.
+ * 메모리가 없거나 이미 등록된 위치면 공유하지 않는다. */
+static void
+file_backed_publish (struct page *page) {
+	struct file_page *file_page = &page->file;
+	struct file_share key, *share;
+
+	share = malloc (sizeof *share);
+	if (share == NULL)
+		return;
+	share->inode = file_get_inode (file_page->file);
+	share->ofs = file_page->ofs;
+	share->frame = page->frame;
+	list_init (&share->pages);
+	list_push_back (&share->pages, &file_page->share_elem);
+
+	lock_acquire (&share_lock);
+	key = *share;
+	if (hash_find (&share_table, &key.hash_elem) == NULL) {
+		hash_insert (&share_table, &share->hash_elem);
+		file_page->share = share;
+	} else
+		free (share);
+	lock_release (&share_lock);
+}
+
+/* 프레임 내용을 파일에 다시 쓴다. 파일 길이를 넘어서는 부분은 쓰지 않는다. */
+static void
+file_backed_write_back (struct page *page, void *kva) {
+	struct file_page *file_page = &page->file;
+	bool locked = filesys_lock_acquire ();
+
+	file_write_at (file_page->file, kva, file_page->read_bytes, file_page->ofs);
+	if (locked)
+		lock_release (&filesys_lock);
 }
 
 /* Swap out the page by writeback contents to the file. */
+/* 이 프레임을 같이 매핑한 페이지들을 모두 떼어내고, 그중 하나라도
+ * dirty 면 한 번만 파일에 다시 쓴다. 깨끗하면 디스크 I/O 는 없다.
+ * PAGE 자신의 매핑은 vm_evict_frame 에서 이미 끊겨 있다. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	struct file_share *share = file_page->share;
+	void *kva = page->frame->kva;
+	bool dirty = pml4_is_dirty (page->pml4, page->va);
+
+	if (share != NULL) {
+		lock_acquire (&share_lock);
+		while (!list_empty (&share->pages)) {
+			struct page *p = list_entry (list_pop_front (&share->pages),
+					struct page, file.share_elem);
+			if (p != page) {
+				dirty |= pml4_is_dirty (p->pml4, p->va);
+				pml4_clear_page (p->pml4, p->va);
+				vm_detach_frame (p, NULL);
+			}
+			p->file.share = NULL;
+		}
+		hash_delete (&share_table, &share->hash_elem);
+		lock_release (&share_lock);
+		free (share);
+	}
+
+	if (dirty)
+		file_backed_write_back (page, kva);
+	pml4_set_dirty (page->pml4, page->va, false);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
+/* dirty 면 다시 쓰고, 프레임을 같이 쓰는 다른 페이지가 남아 있으면
+ * 자기 매핑만 끊는다. 마지막 페이지일 때만 프레임을 돌려준다. */
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	/* 쫓겨나는 중이면 다 내보낼 때까지 기다린 뒤 프레임을 고정한다. */
+	struct frame *frame = vm_hold_frame (page);
+	struct file_share *share = file_page->share;
+
+	if (frame != NULL) {
+		if (pml4_is_dirty (page->pml4, page->va))
+			file_backed_write_back (page, frame->kva);
+
+		if (share != NULL) {
+			lock_acquire (&share_lock);
+			list_remove (&file_page->share_elem);
+			if (list_empty (&share->pages)) {
+				hash_delete (&share_table, &share->hash_elem);
+				free (share);
+				share = NULL;
+			} else
+				vm_detach_frame (page, list_entry (list_front (&share->pages),
+						struct page, file.share_elem));
+			lock_release (&share_lock);
+		}
+
+		if (share != NULL) {
+			pml4_clear_page (page->pml4, page->va);
+			vm_unpin_frame (frame);
+		} else
+			vm_free_frame (page);
+	}
+	file_close (file_page->file);
 }
 
 /* Do the mmap */
+/* FILE 의 OFFSET 부터 LENGTH 바이트를 ADDR 에 lazy 하게 매핑한다.
+ * 페이지마다 파일을 따로 열어 두어서 원래 fd 를 닫아도 매핑은 남는다.
+ * 파일 끝을 넘는 부분은 0 으로 채워진다. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->proc->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	off_t file_len = file_length (file);
+	uint8_t *upage = addr;
+
+	lock_acquire (&spt->lock);
+	/* 이미 쓰이고 있는 페이지와 겹치면 안 된다. */
+	for (size_t i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, upage + i * PGSIZE) != NULL) {
+			lock_release (&spt->lock);
+			return NULL;
+		}
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		off_t ofs = offset + i * PGSIZE;
+		struct lazy_load_info *aux = malloc (sizeof *aux);
+
+		if (aux == NULL)
+			goto fail;
+		aux->file = file_reopen (file);
+		aux->ofs = ofs;
+		aux->read_bytes = ofs < file_len
+			? (file_len - ofs < PGSIZE ? file_len - ofs : PGSIZE) : 0;
+		aux->zero_bytes = PGSIZE - aux->read_bytes;
+		aux->map_addr = addr;
+		aux->prefilled = false;
+		if (aux->file == NULL
+				|| !vm_alloc_page_with_initializer (VM_FILE | VM_FILE_LOAD,
+					upage + i * PGSIZE, writable, NULL, aux)) {
+			file_close (aux->file);
+			free (aux);
+			goto fail;
+		}
+	}
+	lock_release (&spt->lock);
+	return addr;
+
+fail:
+	unmap_pages (spt, addr);
+	lock_release (&spt->lock);
+	return NULL;
+}
+
+/* PAGE 가 속한 mmap 의 시작 주소. mmap 페이지가 아니면 NULL. */
+static void *
+page_map_addr (struct page *page) {
+	if (page_get_type (page) != VM_FILE)
+		return NULL;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return ((struct lazy_load_info *) page->uninit.aux)->map_addr;
+	return page->file.map_addr;
 }
 
 /* Do the munmap */
+/* ADDR 에서 시작한 매핑의 페이지들을 모두 없앤다. dirty 페이지는
+ * destroy 에서 파일에 다시 쓰인다. */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->proc->spt;
+
+	lock_acquire (&spt->lock);
+	unmap_pages (spt, addr);
+	lock_release (&spt->lock);
+}
+
+/* spt->lock 을 잡은 채로 ADDR 에서 시작한 매핑을 없앤다. */
+static void
+unmap_pages (struct supplemental_page_table *spt, void *addr) {
+	uint8_t *upage = addr;
+	struct page *page;
+
+	while ((page = spt_find_page (spt, upage)) != NULL
+			&& page_map_addr (page) == addr) {
+		spt_remove_page (spt, page);
+		upage += PGSIZE;
+	}
 }
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/malloc.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -65,4 +66,10 @@ uninit_destroy (struct page *page) {
 	struct uninit_page *uninit UNUSED = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
+	/* 한 번도 안 올라온 파일 로드 페이지는 aux 가 들고 있던 파일을 닫는다. */
+	if ((uninit->type & VM_FILE_LOAD) && uninit->aux != NULL) {
+		struct lazy_load_info *info = uninit->aux;
+		file_close (info->file);
+		free (info);
+	}
 }
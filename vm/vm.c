@@ -1,9 +1,57 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <string.h>
+#include "threads/flags.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 
+/* 한 번의 read fault 에서 같이 매핑해 줄 이웃 페이지 창의 크기.
+ * 폴트 주소를 이 크기로 정렬한 창 안의 페이지들을 대상으로 한다. */
+#define FAULT_AROUND_PAGES 8
+
+/* push/call 은 rsp 보다 8바이트 아래를 먼저 건드리고 폴트가 난다. */
+#define STACK_SLOP 8
+
+/* 유저 스택이 자랄 수 있는 최대 페이지 수. 기본 1MB, -sl 로 바꾼다. */
+size_t stack_page_limit = (1 << 20) / PGSIZE;
+
+/* 프레임 테이블. 모든 유저 프레임이 여기에 들어가고,
+ * clock_hand 가 이 리스트를 돌면서 희생 프레임을 고른다. */
+static struct list frame_table;
+static struct lock frame_lock;
+static struct list_elem *clock_hand;
+
+/* 쫓아내기가 끝날 때마다 frame_lock 과 함께 깨운다. 쫓겨나는 중인
+ * 페이지를 정리하거나 다시 올리려는 스레드가 여기서 기다린다. */
+static struct condition evict_done;
+static int evict_inflight;
+
+/* 유저 풀의 빈 페이지가 low 밑으로 내려가면 reclaim 스레드를 깨워서
+ * high 가 될 때까지 미리 쫓아내 둔다. 폴트 경로에서는 보통 빈 프레임을
+ * 바로 받을 수 있게 된다. 풀 크기에 대한 비율로 정한다. */
+#define RECLAIM_LOW_DIV 32
+#define RECLAIM_HIGH_DIV 16
+
+static size_t reclaim_low, reclaim_high;
+static struct semaphore reclaim_sema;
+static bool reclaim_running;
+
+static void vm_reclaim_daemon (void *aux);
+
+/* struct page / struct frame 전용 slab 캐시. struct page 는
+ * vm_dealloc_page 에서 free() 로 풀지만 free() 가 slab 객체를 알아본다. */
+static struct kmem_cache *page_cache;
+static struct kmem_cache *frame_cache;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -16,6 +64,20 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	clock_hand = NULL;
+	cond_init (&evict_done);
+	evict_inflight = 0;
+	page_cache = kmem_cache_create ("page", sizeof (struct page), 0, NULL);
+	frame_cache = kmem_cache_create ("frame", sizeof (struct frame), 0, NULL);
+	ASSERT (page_cache != NULL && frame_cache != NULL);
+
+	reclaim_low = palloc_pool_size (PAL_USER) / RECLAIM_LOW_DIV + 1;
+	reclaim_high = palloc_pool_size (PAL_USER) / RECLAIM_HIGH_DIV + 2;
+	sema_init (&reclaim_sema, 0);
+	reclaim_running = false;
+	thread_create ("reclaimd", PRI_DEFAULT, vm_reclaim_daemon, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -36,6 +98,15 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static struct frame *vm_get_free_frame (enum palloc_flags flags);
+static bool vm_can_map_zero (struct page *page);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static bool vm_can_fault_around (struct page *page);
+static void vm_fault_around (struct supplemental_page_table *spt,
+		struct page *page);
+static bool vm_handle_fault_locked (struct supplemental_page_table *spt,
+		struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -46,15 +117,39 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
 
-	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct supplemental_page_table *spt = &thread_current ()->proc->spt;
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
 		/* TODO: Create the page, fetch the initialier according to the VM type,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
+		struct page *page = kmem_cache_alloc (page_cache);
+		if (page == NULL)
+			goto err;
+
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				free (page);
+				goto err;
+		}
+		uninit_new (page, pg_round_down (upage), init, type, aux, initializer);
+		page->pml4 = thread_current ()->pml4;
+		page->writable = writable;
 
 		/* TODO: Insert the page into the spt. */
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -65,6 +160,13 @@ struct page *
 spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	struct page *page = NULL;
 	/* TODO: Fill this function. */
+	struct page key;
+	struct hash_elem *e;
+
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.hash_elem);
+	if (e != NULL)
+		page = hash_entry (e, struct page, hash_elem);
 
 	return page;
 }
@@ -75,21 +177,46 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 		struct page *page UNUSED) {
 	int succ = false;
 	/* TODO: Fill this function. */
+	succ = hash_insert (&spt->pages, &page->hash_elem) == NULL;
 
 	return succ;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->hash_elem);
 	vm_dealloc_page (page);
-	return true;
 }
 
 /* Get the struct frame, that will be evicted. */
+/* clock 알고리즘. 최근에 접근된 프레임은 accessed 비트만 지우고
+ * 넘어가고, 두 바퀴 안에 접근 안 된 프레임을 고른다.
+ * frame_lock 을 잡은 상태에서 불러야 한다. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
+	size_t cnt = list_size (&frame_table) * 2;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (cnt-- > 0) {
+		if (clock_hand == NULL || clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+		struct frame *frame = list_entry (clock_hand, struct frame, frame_elem);
+		clock_hand = list_next (clock_hand);
+
+		/* 다른 스레드가 쫓아내는 중이거나 아직 연결 전인 프레임,
+		 * 또는 futex 가 고정한 프레임 */
+		if (frame->page == NULL || frame->evicting || frame->pin_cnt > 0)
+			continue;
+		if (pml4_is_accessed (frame->page->pml4, frame->page->va)) {
+			pml4_set_accessed (frame->page->pml4, frame->page->va, false);
+			continue;
+		}
+		victim = frame;
+		break;
+	}
 
 	return victim;
 }
@@ -98,46 +225,424 @@ vm_get_victim (void) {
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
+	struct frame *victim UNUSED;
+	struct page *page;
+	bool ok;
 	/* TODO: swap out the victim and return the evicted frame. */
+	lock_acquire (&frame_lock);
+	victim = vm_get_victim ();
+	if (victim == NULL) {
+		lock_release (&frame_lock);
+		return NULL;
+	}
+	/* 희생 프레임을 페이지에서 떼어 놔서 다른 스레드가 다시 고르지 않게 하고,
+	 * 끝날 때까지 destroy 나 폴트가 이 프레임을 건드리지 않도록 표시한다. */
+	page = victim->page;
+	victim->page = NULL;
+	victim->evicting = true;
+	evict_inflight++;
+	lock_release (&frame_lock);
+
+	/* 쓰는 도중에 내용이 바뀌지 않도록 매핑부터 끊는다.
+	 * present 비트만 지우므로 dirty 비트는 swap_out 에서 그대로 볼 수 있다. */
+	pml4_clear_page (page->pml4, page->va);
+	ok = swap_out (page);
+	if (!ok) {
+		/* 내보내지 못했으면 내용이 프레임에만 있으니 다시 매핑해 둔다.
+		 * accessed 를 켜 두어 clock 이 바로 다시 고르지 않게 한다. */
+		pml4_set_page (page->pml4, page->va, victim->kva, page->writable);
+		pml4_set_dirty (page->pml4, page->va, true);
+		pml4_set_accessed (page->pml4, page->va, true);
+	}
+
+	/* page->frame 은 frame_lock 안에서 끊어야 기다리던 쪽이 끊긴 걸 본다. */
+	lock_acquire (&frame_lock);
+	if (ok)
+		page->frame = NULL;
+	else
+		victim->page = page;
+	victim->evicting = false;
+	evict_inflight--;
+	cond_broadcast (&evict_done, &frame_lock);
+	lock_release (&frame_lock);
+
+	return ok ? victim : NULL;
+}
+
+/* PAGE 가 쫓겨나는 중이면 끝날 때까지 기다린다.
+ * frame_lock 을 잡은 상태에서 불러야 한다. */
+static void
+vm_wait_eviction (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait (&evict_done, &frame_lock);
+}
+
+/* 쫓아내는 중인 프레임이 있으면 하나 끝날 때까지 기다리고 true,
+ * 없으면 바로 false 를 돌려준다. */
+static bool
+vm_wait_any_eviction (void) {
+	bool waited = false;
+
+	lock_acquire (&frame_lock);
+	if (evict_inflight > 0) {
+		cond_wait (&evict_done, &frame_lock);
+		waited = true;
+	}
+	lock_release (&frame_lock);
+	return waited;
+}
+
+/* PAGE 의 프레임이 쫓겨나는 중이면 끝나기를 기다린 뒤, 남아 있는
+ * 프레임을 고정해서 돌려준다. 프레임이 없으면 NULL.
+ * destroy 에서 프레임을 풀기 전에 부르고, 고정은 vm_free_frame() 이나
+ * vm_unpin_frame() 이 푼다. */
+struct frame *
+vm_hold_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	vm_wait_eviction (page);
+	frame = page->frame;
+	if (frame != NULL)
+		frame->pin_cnt++;
+	lock_release (&frame_lock);
+	return frame;
+}
+
+/* 프레임을 같이 쓰던 PAGE 를 프레임에서 끊는다. 프레임이 PAGE 를 가리키고
+ * 있었으면 HEIR 로 넘긴다. clock 과 vm_hold_frame() 이 frame_lock 안에서
+ * 보는 값이라 바꿀 때도 frame_lock 을 잡는다. */
+void
+vm_detach_frame (struct page *page, struct page *heir) {
+	lock_acquire (&frame_lock);
+	if (page->frame != NULL && page->frame->page == page)
+		page->frame->page = heir;
+	page->frame = NULL;
+	lock_release (&frame_lock);
+}
 
-	return NULL;
+/* 빈 페이지가 low 밑이면 reclaim 스레드를 깨운다. */
+static void
+vm_reclaim_kick (void) {
+	if (palloc_free_cnt (PAL_USER) < reclaim_low && !reclaim_running) {
+		reclaim_running = true;
+		sema_up (&reclaim_sema);
+	}
+}
+
+/* 유저 풀 페이지 KVA 로 프레임을 만들어 프레임 테이블에 넣는다.
+ * 메모리가 없으면 NULL 이고 KVA 는 부른 쪽이 푼다. */
+static struct frame *
+vm_new_frame (void *kva) {
+	struct frame *frame = kmem_cache_alloc (frame_cache);
+
+	if (frame == NULL)
+		return NULL;
+	frame->kva = kva;
+	frame->page = NULL;
+	frame->pin_cnt = 0;
+	frame->evicting = false;
+	frame->dead = false;
+
+	lock_acquire (&frame_lock);
+	list_push_back (&frame_table, &frame->frame_elem);
+	lock_release (&frame_lock);
+	return frame;
+}
+
+/* 유저 풀에서 빈 페이지를 받아 프레임을 만든다. FLAGS 에 PAL_ZERO 가
+ * 있으면 0 으로 채워진 프레임을 준다.
+ * 빈 페이지가 없으면 쫓아내지 않고 NULL 을 돌려준다. */
+static struct frame *
+vm_get_free_frame (enum palloc_flags flags) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER | flags);
+
+	vm_reclaim_kick ();
+	if (kva == NULL)
+		return NULL;
+	frame = vm_new_frame (kva);
+	if (frame == NULL)
+		palloc_free_page (kva);
+	return frame;
+}
+
+/* 프레임 테이블에서 FRAME 을 빼고 유저 풀로 돌려준다. */
+static void
+vm_release_frame (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	if (clock_hand == &frame->frame_elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->frame_elem);
+	lock_release (&frame_lock);
+
+	palloc_free_page (frame->kva);
+	kmem_cache_free (frame_cache, frame);
+}
+
+/* 빈 페이지가 low 밑으로 떨어지면 깨어나서 high 가 될 때까지
+ * 희생 프레임을 내보내고 풀에 돌려준다. 쫓아낼 게 없으면 다음에
+ * 다시 깨워질 때까지 잔다. */
+static void
+vm_reclaim_daemon (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&reclaim_sema);
+		while (palloc_free_cnt (PAL_USER) < reclaim_high) {
+			struct frame *frame = vm_evict_frame ();
+
+			if (frame == NULL)
+				break;
+			vm_release_frame (frame);
+		}
+		reclaim_running = false;
+	}
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
+/* 스왑까지 가득 차서 어떤 프레임도 내보낼 수 없으면 NULL 을 돌려주고,
+ * 폴트를 낸 프로세스만 끝나게 한다. */
 static struct frame *
-vm_get_frame (void) {
+vm_get_frame (enum palloc_flags flags) {
 	struct frame *frame = NULL;
+	size_t tries = 0, frame_cnt;
 	/* TODO: Fill this function. */
+	lock_acquire (&frame_lock);
+	frame_cnt = list_size (&frame_table);
+	lock_release (&frame_lock);
+
+	for (;;) {
+		frame = vm_get_free_frame (flags);
+		if (frame != NULL)
+			break;
+		frame = vm_evict_frame ();
+		if (frame != NULL) {
+			if (flags & PAL_ZERO)
+				memset (frame->kva, 0, PGSIZE);
+			break;
+		}
+		/* 희생을 스왑에 못 내보냈으면 clock 이 다음 희생을 고르도록
+		 * 프레임 수만큼 더 해 본다. */
+		if (++tries < frame_cnt)
+			continue;
+		/* 다른 스레드가 쫓아내는 중이면 끝나기를 기다렸다 다시 본다. */
+		if (!vm_wait_any_eviction ())
+			break;
+	}
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	ASSERT (frame == NULL || frame->page == NULL);
 	return frame;
 }
 
+/* PAGE 에 연결된 프레임을 매핑에서 떼어내고 유저 풀로 돌려준다.
+ * 각 페이지 타입의 destroy 에서 vm_hold_frame() 으로 고정해 두고 정리가
+ * 끝난 뒤 부른다. futex 처럼 다른 쪽도 고정하고 있으면 프레임 테이블에서만
+ * 빼 두고 마지막 vm_unpin_frame() 이 푼다. */
+void
+vm_free_frame (struct page *page) {
+	struct frame *frame = page->frame;
+	bool last;
+
+	if (frame == NULL)
+		return;
+
+	pml4_clear_page (page->pml4, page->va);
+
+	lock_acquire (&frame_lock);
+	ASSERT (frame->pin_cnt > 0);
+	page->frame = NULL;
+	frame->page = NULL;
+	frame->dead = true;
+	if (clock_hand == &frame->frame_elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->frame_elem);
+	last = --frame->pin_cnt == 0;
+	lock_release (&frame_lock);
+
+	if (last) {
+		palloc_free_page (frame->kva);
+		kmem_cache_free (frame_cache, frame);
+	}
+}
+
+/* 유저 단어 VA 가 든 페이지를 쓸 수 있는 자기 프레임에 올리고 쫓겨나지
+ * 않게 고정한 뒤 VA 의 커널 주소를 돌려준다. 쓸 수 없는 주소면 NULL.
+ * 고정한 프레임은 *FRAMEP 로 주고 vm_unpin_frame() 으로 푼다. */
+void *
+vm_pin_user (void *va, struct frame **framep) {
+	struct supplemental_page_table *spt = &thread_current ()->proc->spt;
+	struct page *page;
+
+	for (;;) {
+		if (!touch_user_write (va))
+			return NULL;
+
+		/* 같은 주소 공간의 다른 스레드가 munmap 하지 못하게 spt 를 잡고 고정한다. */
+		lock_acquire (&spt->lock);
+		page = spt_find_page (spt, va);
+		lock_acquire (&frame_lock);
+		if (page != NULL && page->frame != NULL && !page->frame->evicting) {
+			*framep = page->frame;
+			(*framep)->pin_cnt++;
+			lock_release (&frame_lock);
+			lock_release (&spt->lock);
+			return (uint8_t *) (*framep)->kva + pg_ofs (va);
+		}
+		lock_release (&frame_lock);
+		lock_release (&spt->lock);
+		/* 올린 사이에 쫓겨나는 중이다. 끝나면 다시 올린다. */
+		thread_yield ();
+	}
+}
+
+/* vm_pin_user() 나 vm_hold_frame() 으로 고정한 FRAME 을 푼다.
+ * 고정된 사이에 페이지가 사라졌으면 마지막으로 푸는 쪽이 프레임을 돌려준다. */
+void
+vm_unpin_frame (struct frame *frame) {
+	bool last;
+
+	lock_acquire (&frame_lock);
+	ASSERT (frame->pin_cnt > 0);
+	last = --frame->pin_cnt == 0 && frame->dead;
+	lock_release (&frame_lock);
+
+	if (last) {
+		palloc_free_page (frame->kva);
+		kmem_cache_free (frame_cache, frame);
+	}
+}
+
+/* ADDR 이 RSP 기준으로 스택 접근으로 볼 수 있는지 확인한다.
+ * rsp 위쪽이거나 push 로 rsp 바로 아래를 건드린 경우만 인정하고,
+ * 스택 한도 밖은 거절한다. */
+static bool
+vm_is_stack_access (void *addr, uintptr_t rsp) {
+	uintptr_t va = (uintptr_t) addr;
+	uintptr_t limit = USER_STACK - stack_page_limit * PGSIZE;
+
+	if (va >= USER_STACK || va < limit)
+		return false;
+	return rsp >= STACK_SLOP && va >= rsp - STACK_SLOP;
+}
+
 /* Growing the stack. */
+/* 현재 스택 바닥부터 ADDR 이 있는 페이지까지 빈 페이지들을 한 번에
+ * 잡아 둔다. 큰 지역 변수처럼 바닥에서 멀리 떨어진 곳에 폴트가 나도
+ * 페이지마다 폴트를 다시 낼 필요가 없다. 실제 프레임은 처음 접근할 때 받는다.
+ * 새 바닥 바로 아래 페이지가 이미 다른 매핑이면 가드 페이지가 없어지므로
+ * 더 자라지 않는다. */
 static void
 vm_stack_growth (void *addr UNUSED) {
+	struct thread *t = thread_current ()->proc;
+	uint8_t *target = pg_round_down (addr);
+	uint8_t *bottom = t->stack_bottom;
+	uintptr_t limit = USER_STACK - stack_page_limit * PGSIZE;
+
+	if (target >= bottom)
+		return;
+	if ((uintptr_t) target > limit
+			&& spt_find_page (&t->spt, target - PGSIZE) != NULL)
+		return;
+
+	while (bottom > target) {
+		if (!vm_alloc_page (VM_ANON | VM_STACK, bottom - PGSIZE, true))
+			break;
+		bottom -= PGSIZE;
+	}
+	t->stack_bottom = bottom;
+}
+
+/* zero 프레임으로 대신할 수 있는 페이지인지 확인한다.
+ * 초기화 함수 없이 0 으로만 채워질 anon 페이지가 대상이다. */
+static bool
+vm_can_map_zero (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT)
+		return false;
+	if (VM_TYPE (page->uninit.type) != VM_ANON)
+		return false;
+	return page->uninit.init == NULL && page->uninit.aux == NULL;
 }
 
 /* Handle the fault on write_protected page */
+/* zero 프레임을 보고 있던 페이지에 처음 쓰면 자기 프레임을 받는다. */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
+	if (page_get_type (page) != VM_ANON || !page->anon.zero_mapped)
+		return false;
+
+	pml4_clear_page (page->pml4, page->va);
+	return vm_do_claim_page (page);
 }
 
 /* Return true on success */
 bool
 vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
+	struct supplemental_page_table *spt UNUSED = &thread_current ()->proc->spt;
+	bool success;
+
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+
+	/* 같은 주소 공간의 스레드 둘이 한 페이지를 동시에 올리지 않게 한다. */
+	lock_acquire (&spt->lock);
+	success = vm_handle_fault_locked (spt, f, addr, user, write, not_present);
+	lock_release (&spt->lock);
+	return success;
+}
 
-	return vm_do_claim_page (page);
+/* spt->lock 을 잡은 채로 ADDR 의 폴트를 처리한다. */
+static bool
+vm_handle_fault_locked (struct supplemental_page_table *spt,
+		struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present) {
+	struct page *page;
+	bool around;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		/* 커널 모드 폴트면 f->rsp 는 커널 스택이라 시스템 콜 진입 때
+		 * 저장해 둔 유저 rsp 를 쓴다. */
+		uintptr_t rsp = user ? f->rsp : thread_current ()->user_rsp;
+
+		if (!vm_is_stack_access (addr, rsp))
+			return false;
+		vm_stack_growth (addr);
+		page = spt_find_page (spt, addr);
+		if (page == NULL)
+			return false;
+	}
+
+	if (write && !page->writable)
+		return false;
+
+	/* 쫓겨나는 중인 페이지는 다 내보낸 뒤에 다시 올린다. */
+	lock_acquire (&frame_lock);
+	vm_wait_eviction (page);
+	lock_release (&frame_lock);
+	if (!not_present)
+		return vm_handle_wp (page);
+
+	/* 쓴 적 없는 anon 페이지를 읽기만 하면 프레임을 받지 않는다.
+	 * CR0.WP 가 꺼져 있으면 커널이 유저 버퍼에 쓸 때 읽기 전용 비트를
+	 * 무시하고 공유 zero 프레임을 덮어쓰므로 그때는 매핑하지 않는다. */
+	if (!write && (rcr0 () & CR0_WP) && vm_can_map_zero (page))
+		return anon_map_zero (page);
+
+	/* 읽기 폴트면 파일에서 읽어 오는 이웃 페이지들도 같이 매핑해서
+	 * 순차 접근할 때 폴트 횟수를 줄인다. */
+	around = !write && vm_can_fault_around (page);
+	if (!vm_do_claim_page (page))
+		return false;
+	if (around)
+		vm_fault_around (spt, page);
+	return true;
 }
 
 /* Free the page.
@@ -153,6 +658,9 @@ bool
 vm_claim_page (void *va UNUSED) {
 	struct page *page = NULL;
 	/* TODO: Fill this function */
+	page = spt_find_page (&thread_current ()->proc->spt, va);
+	if (page == NULL)
+		return false;
 
 	return vm_do_claim_page (page);
 }
@@ -160,26 +668,295 @@ vm_claim_page (void *va UNUSED) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct frame *frame;
+
+	/* 같은 파일 위치가 이미 올라와 있으면 그 프레임을 같이 쓴다. */
+	if (page_get_type (page) == VM_FILE && file_backed_share (page))
+		return true;
+
+	/* 0 으로 시작하는 anon 페이지는 미리 0 으로 채워 둔 페이지를 받는다. */
+	if (vm_can_map_zero (page)
+			|| (VM_TYPE (page->operations->type) == VM_ANON
+				&& page->anon.zero_mapped))
+		frame = vm_get_frame (PAL_ZERO);
+	else
+		frame = vm_get_frame (0);
+	if (frame == NULL)
+		return false;
+	return vm_map_frame (page, frame);
+}
+
+/* FRAME 에 PAGE 의 내용을 채운 뒤 연결하고 페이지 테이블에 올린다.
+ * 다 채우기 전에는 매핑하지 않으므로 읽다 실패해도 반쯤 찬 페이지가
+ * 보이지 않는다. 채우는 동안은 frame->page 가 NULL 이라 clock 도
+ * 이 프레임을 고르지 않는다. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame) {
+	page->frame = frame;
+	if (!swap_in (page, frame->kva)) {
+		page->frame = NULL;
+		vm_release_frame (frame);
+		return false;
+	}
 
 	/* Set links */
+	lock_acquire (&frame_lock);
 	frame->page = page;
-	page->frame = frame;
+	lock_release (&frame_lock);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	/* 매핑에 실패해도 프레임은 페이지에 남아 destroy 때 타입에 맞게 정리된다. */
+	return pml4_set_page (page->pml4, page->va, frame->kva, page->writable);
+}
+
+/* fault-around 대상인지 확인한다. 아직 프레임이 없고,
+ * 파일에서 한 번에 읽어올 수 있는 페이지만 대상으로 한다. */
+static bool
+vm_can_fault_around (struct page *page) {
+	if (page->frame != NULL)
+		return false;
+	if (VM_TYPE (page->operations->type) == VM_FILE)
+		return true;
+	if (VM_TYPE (page->operations->type) != VM_UNINIT)
+		return false;
+	return (page->uninit.type & VM_FILE_LOAD) != 0;
+}
+
+/* 아직 한 번도 안 올라온 파일 로드 페이지면 그 aux, 아니면 NULL. */
+static struct lazy_load_info *
+fault_around_info (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT)
+		return NULL;
+	return page->uninit.aux;
+}
+
+/* B 가 A 바로 다음 파일 위치를 읽는 페이지라서 한 번에 읽을 수 있는지. */
+static bool
+fault_around_contig (struct page *a, struct page *b) {
+	struct lazy_load_info *ia = fault_around_info (a);
+	struct lazy_load_info *ib = fault_around_info (b);
+
+	return ia != NULL && ib != NULL && ia->read_bytes == PGSIZE
+		&& file_get_inode (ia->file) == file_get_inode (ib->file)
+		&& ib->ofs == ia->ofs + PGSIZE;
+}
+
+/* 파일에서 이어지는 페이지 RUN[0..CNT) 을 이어진 빈 페이지 CNT 개에
+ * file_read_at 한 번으로 읽어 들인 뒤 페이지마다 매핑한다. 이미 한 번
+ * 올라왔던 mmap 페이지는 혼자서 swap_in 으로 읽는다. 빈 페이지가
+ * 모자라거나 읽기에 실패하면 false 를 돌려 fault-around 를 멈춘다. */
+static bool
+fault_around_read (struct page **run, size_t cnt) {
+	struct lazy_load_info *first;
+	uint8_t *kva;
+	size_t bytes = 0, i;
+	bool held;
+	off_t read;
+
+	if (cnt == 0)
+		return true;
+	if ((first = fault_around_info (run[0])) == NULL) {
+		struct frame *frame = vm_get_free_frame (0);
+
+		ASSERT (cnt == 1);
+		if (frame == NULL || !vm_map_frame (run[0], frame))
+			return false;
+		pml4_set_accessed (run[0]->pml4, run[0]->va, false);
+		return true;
+	}
+
+	kva = palloc_get_multiple (PAL_USER, cnt);
+	vm_reclaim_kick ();
+	if (kva == NULL)
+		return false;
+	for (i = 0; i < cnt; i++)
+		bytes += fault_around_info (run[i])->read_bytes;
+
+	held = lock_held_by_current_thread (&filesys_lock);
+	if (!held)
+		lock_acquire (&filesys_lock);
+	read = file_read_at (first->file, kva, bytes, first->ofs);
+	if (!held)
+		lock_release (&filesys_lock);
+	if (read != (off_t) bytes) {
+		palloc_free_multiple (kva, cnt);
+		return false;
+	}
+
+	/* 페이지마다 자기 프레임이 되고, 나중에 따로따로 풀린다. */
+	for (i = 0; i < cnt; i++) {
+		struct frame *frame = vm_new_frame (kva + i * PGSIZE);
+
+		if (frame == NULL) {
+			palloc_free_multiple (kva + i * PGSIZE, cnt - i);
+			return false;
+		}
+		fault_around_info (run[i])->prefilled = true;
+		if (!vm_map_frame (run[i], frame)) {
+			palloc_free_multiple (kva + (i + 1) * PGSIZE, cnt - i - 1);
+			return false;
+		}
+		pml4_set_accessed (run[i]->pml4, run[i]->va, false);
+	}
+	return true;
+}
+
+/* PAGE 주변 FAULT_AROUND_PAGES 창 안의 페이지들을 미리 매핑한다.
+ * 파일에서 이어지는 페이지끼리 묶어 한 번에 읽는다.
+ * 빈 프레임이 있을 때만 하고, 이걸 위해 다른 페이지를 쫓아내지는 않는다.
+ * 미리 올린 페이지는 accessed 비트를 지워 두어서 실제로 안 쓰이면
+ * clock 에서 먼저 나가게 한다. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page) {
+	struct page *run[FAULT_AROUND_PAGES];
+	size_t cnt = 0;
+	uint8_t *start;
+
+	start = (uint8_t *) ((uint64_t) page->va
+			& ~((uint64_t) FAULT_AROUND_PAGES * PGSIZE - 1));
+	for (int i = 0; i < FAULT_AROUND_PAGES; i++) {
+		struct page *p = spt_find_page (spt, start + i * PGSIZE);
+
+		if (p == NULL || p == page || !vm_can_fault_around (p)
+				|| (page_get_type (p) == VM_FILE && file_backed_share (p))) {
+			if (!fault_around_read (run, cnt))
+				return;
+			cnt = 0;
+			continue;
+		}
+		if (cnt > 0 && !fault_around_contig (run[cnt - 1], p)) {
+			if (!fault_around_read (run, cnt))
+				return;
+			cnt = 0;
+		}
+		run[cnt++] = p;
+	}
+	fault_around_read (run, cnt);
+}
 
-	return swap_in (page, frame->kva);
+/* spt 해시 함수들 */
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *p = hash_entry (e, struct page, hash_elem);
+	return hash_bytes (&p->va, sizeof p->va);
+}
+
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page *a = hash_entry (a_, struct page, hash_elem);
+	const struct page *b = hash_entry (b_, struct page, hash_elem);
+	return a->va < b->va;
+}
+
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED) {
+	struct page *page = hash_entry (e, struct page, hash_elem);
+	vm_dealloc_page (page);
 }
 
 /* Initialize new supplemental page table */
 void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+	hash_init (&spt->pages, page_hash, page_less, NULL);
+	lock_init (&spt->lock);
+}
+
+/* SRC 의 내용을 방금 올린 DST 프레임에 복사한다. 복사하는 동안 두 프레임이
+ * 쫓겨나지 않게 고정하고, SRC 가 쫓겨나 있으면 먼저 다시 올린다. */
+static bool
+vm_copy_frame (struct page *dst, struct page *src) {
+	struct frame *dst_frame, *src_frame;
+
+	while ((src_frame = vm_hold_frame (src)) == NULL)
+		if (!vm_do_claim_page (src))
+			return false;
+	dst_frame = vm_hold_frame (dst);
+	if (dst_frame == NULL) {
+		vm_unpin_frame (src_frame);
+		return vm_do_claim_page (dst) && vm_copy_frame (dst, src);
+	}
+
+	memcpy (dst_frame->kva, src_frame->kva, PGSIZE);
+	vm_unpin_frame (dst_frame);
+	vm_unpin_frame (src_frame);
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		struct supplemental_page_table *src UNUSED) {
+	struct hash_iterator i;
+
+	hash_first (&i, &src->pages);
+	while (hash_next (&i)) {
+		struct page *src_page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		enum vm_type type = src_page->operations->type;
+		void *va = src_page->va;
+
+		/* 아직 한 번도 안 쓰인 페이지는 aux 만 복사해서 똑같이 lazy 하게 */
+		if (VM_TYPE (type) == VM_UNINIT) {
+			struct lazy_load_info *aux = src_page->uninit.aux;
+
+			if (aux != NULL) {
+				struct lazy_load_info *src_aux = aux;
+				aux = malloc (sizeof *aux);
+				if (aux == NULL)
+					return false;
+				*aux = *src_aux;
+				aux->file = file_reopen (src_aux->file);
+				if (aux->file == NULL) {
+					free (aux);
+					return false;
+				}
+			}
+			if (!vm_alloc_page_with_initializer (src_page->uninit.type, va,
+						src_page->writable, src_page->uninit.init, aux))
+				return false;
+			continue;
+		}
+
+		/* mmap 페이지는 같은 파일 위치를 다시 lazy 하게 매핑한다.
+		 * 부모가 아직 프레임을 들고 있으면 처음 접근할 때 그걸 같이 쓴다. */
+		if (VM_TYPE (type) == VM_FILE) {
+			struct lazy_load_info *aux = malloc (sizeof *aux);
+
+			if (aux == NULL)
+				return false;
+			*aux = (struct lazy_load_info) {
+				.file = file_reopen (src_page->file.file),
+				.ofs = src_page->file.ofs,
+				.read_bytes = src_page->file.read_bytes,
+				.zero_bytes = src_page->file.zero_bytes,
+				.map_addr = src_page->file.map_addr,
+			};
+			if (aux->file == NULL
+					|| !vm_alloc_page_with_initializer (VM_FILE | VM_FILE_LOAD, va,
+						src_page->writable, NULL, aux)) {
+				file_close (aux->file);
+				free (aux);
+				return false;
+			}
+			continue;
+		}
+
+		/* zero 프레임만 보고 있던 페이지는 자식도 처음부터 다시 시작한다. */
+		if (VM_TYPE (type) == VM_ANON && src_page->anon.zero_mapped) {
+			if (!vm_alloc_page (VM_ANON, va, src_page->writable))
+				return false;
+			continue;
+		}
+
+		/* 이미 올라온 적 있는 페이지는 바로 받아서 내용을 복사한다.
+		 * 부모 쪽이 쫓겨나 있으면 먼저 다시 올린다. */
+		if (!vm_alloc_page (type, va, src_page->writable)
+				|| !vm_claim_page (va))
+			return false;
+		if (!vm_copy_frame (spt_find_page (dst, va), src_page))
+			return false;
+	}
+	return true;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -187,4 +964,5 @@ void
 supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
+	hash_clear (&spt->pages, page_destructor);
 }